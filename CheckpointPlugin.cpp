@@ -8,6 +8,8 @@
 
 #include "pch.h"
 #include "CheckpointPlugin.h"
+#include "alloccount.h"
+#include "core/savefile.h"
 
 #include "bakkesmod/wrappers/GameEvent/TutorialWrapper.h"
 #include "bakkesmod/wrappers/GameObject/CarComponent/BoostWrapper.h"
@@ -16,20 +18,47 @@
 
 #include "bakkesmod/wrappers/ArrayWrapper.h"
 
+#include <chrono>
+#include <sstream>
+
 using namespace std::placeholders;
 
 std::string_view DEFAULT_SAVE_FILE_NAME = "freeplaycheckpoint.data";
+std::string_view SESSION_FILE_NAME = "freeplaycheckpoint.session";
+std::string_view RECOVERY_FILE_NAME = "freeplaycheckpoint.recovery";
+std::string_view RECOVERED_FILE_NAME = "freeplaycheckpoint.recovered";
+std::string_view TRACE_FILE_NAME = "freeplaycheckpoint.trace";
+std::string_view PROFILE_FILE_NAME = "freeplaycheckpoint.profile.csv";
+std::string_view EVENTS_FILE_NAME = "freeplaycheckpoint.events.log";
+std::string_view HISTORY_CSV_FILE_NAME = "freeplaycheckpoint.history.csv";
+std::string_view META_FILE_SUFFIX = ".meta"; // appended to cpt_filename
+std::string_view STATS_FILE_SUFFIX = ".stats"; // appended to cpt_filename
+std::string_view VARIANTS_FILE_SUFFIX = ".variants"; // appended to cpt_filename
+
+constexpr size_t SIMILAR_MOMENTS = 5; // matches cpt_similar_moment cycles through
+constexpr float SIMILAR_SEPARATION = 1.0f; // s between matches
 
 BAKKESMOD_PLUGIN(CheckpointPlugin, "Freeplay Checkpoint", plugin_version, PLUGINTYPE_FREEPLAY)
 
 std::shared_ptr<CVarManagerWrapper> _globalCvarManager;
 
 // Controlled by cvars.
-float snapshotInterval = 0.010f; //time (s) between updates
+float configuredInterval = 0.010f; // time (s) between updates requested by cpt_snapshot_interval
+float snapshotInterval = configuredInterval; //time (s) between updates
 int historyTime = 30; // length of history (s)
+int historyBudgetMB = 0; // memory budget for history (MB); 0 if unlimited
 int maxHistory = int(historyTime / snapshotInterval); // length of history (GameStates)
 
-void CheckpointPlugin::log(std::string s) {
+constexpr float MAX_SNAPSHOT_INTERVAL = 0.1f; // coarsest interval allowed by cpt_snapshot_interval
+
+void CheckpointPlugin::log(const std::string& s) {
+	if (debug) {
+		cvarManager->log(s);
+	}
+}
+
+// Avoids building a std::string unless debugging.
+void CheckpointPlugin::log(const char* s) {
 	if (debug) {
 		cvarManager->log(s);
 	}
@@ -77,28 +106,41 @@ std::unique_ptr<GameState> CheckpointPlugin::getReplayGameState() {
 			continue;
 		}
 		if (playerName == pri.GetPlayerName().ToString()) {
-			return std::unique_ptr<GameState>(new GameState(car, ball));
+			return std::unique_ptr<GameState>(new GameState(captureGame(car, ball)));
 		}
 	}
 	return nullptr;
 }
 
 void CheckpointPlugin::setFrozen(bool car, bool ball) {
-	rewindMode = car;
-	freezeBall = ball;
-	cvarManager->getCvar("cpt_car_frozen").setValue(car);
-	cvarManager->getCvar("cpt_ball_frozen").setValue(ball);
+	rewinder.rewindMode = car;
+	rewinder.freezeBall = ball;
+	frozenChanged(car, ball);
 }
 
 void CheckpointPlugin::onLoad()
 {
-	boolvar("cpt_clean_history", "If set, deletes history after the current point when exiting rewind mode", &deleteFutureHistory);
+	boolvar("cpt_clean_history", "If set, deletes history after the current point when exiting rewind mode", &rewinder.deleteFutureHistory);
+	boolvar("cpt_preview_future", "If set, rewinding past the newest snapshot previews the ball's predicted flight", &rewinder.previewFuture);
+	auto ghostCV = cvarManager->registerCvar(
+		"cpt_ghost", "0", "Shows an earlier attempt at the checkpoint being played: 0 off, 1 best (soonest goal), 2 most recent", true, true, 0, true, 2);
+	ghostCV.addOnValueChanged([this](std::string old, CVarWrapper now) {
+		ghostMode = GhostMode(now.getIntValue());
+		ghostFor = 0; // Selected again on the next frame.
+	});
+	ghostCV.notify();
 
-	boolvar("cpt_reset_on_goal", "If set, restore last resumed checkpoint when scoring a goal", &resetOnGoal);
-	boolvar("cpt_reset_on_ball_ground", "If set, restore last resumed checkpoint when ball touches ground", &resetOnBallGround);
+	boolvar("cpt_reset_on_goal", "If set, restore last resumed checkpoint when scoring a goal", &rewinder.resetOnGoal);
+	boolvar("cpt_reset_on_ball_ground", "If set, restore last resumed checkpoint when ball touches ground", &rewinder.resetOnBallGround);
 	boolvar("cpt_next_instead_of_reset", "If set, load next checkpoint instead of resetting", &nextInsteadOfReset);
 
 	boolvar("cpt_debug", "If set, render debugging info", &debug);
+	boolvar("cpt_profile", "If set, time the hot paths and show their latency", &profiler.enabled);
+	cvarManager->getCvar("cpt_profile").addOnValueChanged([this](std::string old, CVarWrapper now) {
+		if (now.getBoolValue()) {
+			profiler.reset();
+		}
+	});
 
 	boolvar("cpt_next_prev_when_frozen", "LEGACY; DO NOT USE", &ignorePNNotFrozen);
 	boolvar("cpt_ignore_next", "If set, ignore next when not frozen", &ignorePrev);
@@ -107,6 +149,25 @@ void CheckpointPlugin::onLoad()
 	boolvar("cpt_disable_training", "If set, disable in custom training", &disableTraining);
 	boolvar("cpt_disable_workshop", "If set, disable in workshop", &disableWorkshop);
 	boolvar("cpt_show_boost", "If set, show player boost usage while rewinding", &showBoost);
+	boolvar("cpt_record_session", "If set, record the whole freeplay session to disk", &recordSession);
+	cvarManager->getCvar("cpt_record_session").addOnValueChanged([this](std::string old, CVarWrapper now) {
+		if (!now.getBoolValue()) {
+			sessionRecorder.stop();
+			updateMemoryUsage();
+		}
+	});
+	boolvar("cpt_crash_recovery", "If set, periodically save history to disk so it can be restored after a crash", &crashRecovery);
+	cvarManager->getCvar("cpt_crash_recovery").addOnValueChanged([this](std::string old, CVarWrapper now) {
+		if (!now.getBoolValue()) {
+			recovery.stop(true);
+		}
+	});
+	boolvar("cpt_record_trace", "If set, record every tick's inputs for the trace replayer (bench/replay.cpp)", &recordTrace);
+	cvarManager->getCvar("cpt_record_trace").addOnValueChanged([this](std::string old, CVarWrapper now) {
+		if (!now.getBoolValue() && traceFile.is_open()) {
+			traceFile.close();
+		}
+	});
 
 	// Migration from cpt_next_prev_when_frozen to split variables.
 	if (ignorePNNotFrozen) {
@@ -118,20 +179,21 @@ void CheckpointPlugin::onLoad()
 
 	boolvar("cpt_mirror_loads", "If set, randomly mirror when loading checkpoints", &mirrorLoads);
 	boolvar("cpt_randomize_loads", "If set, load a random checkpoint instead of the latest", &randomizeLoads);
+	boolvar("cpt_weighted_loads", "If set, load checkpoints chosen by how often they are missed, how recently they were played and their priority", &weightedLoads);
 
 	cvarManager->registerCvar("cpt_allow_delete_all", "0", "Enables the delete all button", false, true, 0, true, 1, false);
 
 	cvarManager->registerCvar("cpt_car_frozen", "0", "Set when the car is frozen; read-only", false, true, 0, true, 1, false);
 	cvarManager->registerCvar("cpt_ball_frozen", "0", "Set when the ball is frozen; read-only", false, true, 0, true, 1, false);
 
+	cvarManager->registerCvar("cpt_memory_usage_kb", "0", "Memory used by history and checkpoints (KB); read-only", false, true, 0, false, 0, false);
+
 	auto snapshotIntervalCV = cvarManager->registerCvar(
 		"cpt_snapshot_interval", "1", "Collect a snapshot every <n> milliseconds; changing deletes history", true, true, 1, true, 10, true);
 	snapshotIntervalCV.addOnValueChanged([this](std::string old, CVarWrapper now) {
-		snapshotInterval = now.getIntValue()/100.0f;
-		maxHistory = int(historyTime / snapshotInterval);
-		history.resize(0);
-		setFrozen(false, false);
-		dodgeExpiration = 0.0;
+		configuredInterval = now.getIntValue()/100.0f;
+		snapshotInterval = 0; // Force history to be cleared.
+		updateHistorySize();
 	});
 	snapshotIntervalCV.notify();
 
@@ -139,13 +201,26 @@ void CheckpointPlugin::onLoad()
 		"cpt_history_length", "30", "Save history for <n> seconds", true, true, 10, true, 120, true);
 	historyLenCV.addOnValueChanged([this](std::string old, CVarWrapper now) {
 		historyTime = now.getIntValue();
-		maxHistory = int(historyTime / snapshotInterval);
-		if (history.size() > maxHistory) {
-			history.erase(history.begin(), history.begin() + history.size() - maxHistory);
-		}
+		updateHistorySize();
 	});
 	historyLenCV.notify();
 
+	auto historyBudgetCV = cvarManager->registerCvar(
+		"cpt_history_budget_mb", "0", "Limit history to <n> MB by reducing its refresh rate or length; 0 for no limit", true, true, 0, true, 64, true);
+	historyBudgetCV.addOnValueChanged([this](std::string old, CVarWrapper now) {
+		historyBudgetMB = now.getIntValue();
+		updateHistorySize();
+	});
+	historyBudgetCV.notify();
+
+	auto attemptMemoryCV = cvarManager->registerCvar(
+		"cpt_attempt_memory_mb", "8", "Keep recent attempts at checkpoints in up to <n> MB; changing deletes them", true, true, 0, true, 256, true);
+	attemptMemoryCV.addOnValueChanged([this](std::string old, CVarWrapper now) {
+		rewinder.attempts.setCapacity(size_t(now.getIntValue()) * 1024 * 1024);
+		updateMemoryUsage();
+	});
+	attemptMemoryCV.notify();
+
 	auto filenameCV = cvarManager->registerCvar(
 		"cpt_filename", static_cast<std::string>(DEFAULT_SAVE_FILE_NAME), "Sets the filename to use for saved checkpoints", true, false, 0, false, 0, true);
 	filenameCV.addOnValueChanged([this](std::string old, CVarWrapper now) {
@@ -160,8 +235,24 @@ void CheckpointPlugin::onLoad()
 
 	registerVarianceCVars();
 
+	enableGoalCV = cvarManager->getCvar("sv_soccar_enablegoal");
+
 	loadCheckpointFile();
 
+	// Stages that process recorded snapshots off the game thread.
+	rewinder.events = &events;
+	rewinder.stats = &stats;
+	sessionRecorder.setPath(gameWrapper->GetDataFolder() / SESSION_FILE_NAME);
+	pipeline.addStage(&sessionRecorder);
+
+	recovery.setPath(gameWrapper->GetDataFolder() / RECOVERY_FILE_NAME);
+	pipeline.addStage(&recovery);
+	pipeline.start();
+
+	if (RecoveryWriter::recover(gameWrapper->GetDataFolder() / RECOVERY_FILE_NAME, gameWrapper->GetDataFolder() / RECOVERED_FILE_NAME)) {
+		cvarManager->log("Freeplay Checkpoint did not exit cleanly; enter cpt_restore_history in freeplay to restore history.");
+	}
+
 	// Continually call OnPreAsync.
 	gameWrapper->HookEvent("Function PlayerController_TA.Driving.PlayerMove",
 		bind(&CheckpointPlugin::OnPreAsync, this, _1));
@@ -174,34 +265,56 @@ void CheckpointPlugin::onLoad()
 				return;
 			}
 			int resetDelay = cvarManager->getCvar("cpt_load_after_reset").getIntValue();
-			if (!rewindMode && playingFromCheckpoint && resetDelay > 0) {
+			if (!rewinder.rewindMode && rewinder.playingFromCheckpoint && resetDelay > 0) {
 				ServerWrapper sw = gameWrapper->GetGameEventAsServer();
-				float lastLoad = sw.GetSecondsElapsed() - lastRewindTime;
+				float lastLoad = sw.GetSecondsElapsed() - rewinder.lastRewindTime;
 				if (lastLoad > 0 && lastLoad < resetDelay) {
 					loadLatestCheckpoint();
 					return;
 				}
 			}
-			playingFromCheckpoint = false;
+			rewinder.playingFromCheckpoint = false;
 			setFrozen(false, false);
-			dodgeExpiration = 0.0;
+			rewinder.dodgeExpiration = 0.0;
+		});
+
+	// Finish the session recording when leaving freeplay.
+	gameWrapper->HookEvent("Function TAGame.GameEvent_Soccar_TA.Destroyed",
+		[this](std::string eventName) {
+			sessionRecorder.stop();
+			recovery.stop(true);
+			updateMemoryUsage();
 		});
 
 	gameWrapper->HookEvent("Function TAGame.Ball_TA.OnHitGoal",
 		[this](std::string eventName) {
-			if (!gameWrapper->IsInFreeplay() || rewindMode || !playingFromCheckpoint || !resetOnGoal) {
+			if (!gameWrapper->IsInFreeplay() || rewinder.rewindMode || !rewinder.playingFromCheckpoint) {
 				return;
 			}
-			loadLatestCheckpoint();
+			ServerWrapper sw = gameWrapper->GetGameEventAsServer();
+			if (!sw.IsNull() && !sw.GetBall().IsNull()) {
+				rewinder.scored(sw.GetSecondsElapsed(), toVec3(sw.GetBall().GetVelocity()));
+			}
+			if (rewinder.resetOnGoal) {
+				loadLatestCheckpoint();
+			}
+		});
+
+	// Re-predicts the ball's flight for cpt_reset_on_goal/cpt_reset_on_ball_ground.
+	gameWrapper->HookEvent("Function TAGame.Ball_TA.OnCarTouch",
+		[this](std::string eventName) {
+			rewinder.ballTouched();
+			traceTouched = true;
 		});
 
 	// Enter rewind mode.
 	cvarManager->registerNotifier("cpt_freeze", [this](std::vector<std::string> command) {
-		if (!enabled() || history.size() == 0 || rewindMode || gameWrapper->IsInReplay()) {
+		if (!enabled() || rewinder.history.size() == 0 || rewinder.rewindMode || gameWrapper->IsInReplay()) {
 			return;
 		}
-		latest = history.back();
-		loadGameState(latest);
+		traceCommands |= TRACE_FREEZE;
+		rewinder.latest = rewinder.history.back();
+		loadGameState(rewinder.latest);
 	}, "Activates rewind mode", PERMISSION_ALL);
 
 	// If in play mode, load the latest checkpoint / quick checkpoint.
@@ -212,11 +325,23 @@ void CheckpointPlugin::onLoad()
 	cvarManager->registerNotifier("cpt_prev_checkpoint", std::bind(&CheckpointPlugin::prevCheckpoint, this, _1), "Loads the previous checkpoint", PERMISSION_FREEPLAY);
 	cvarManager->registerNotifier("cpt_next_checkpoint", std::bind(&CheckpointPlugin::nextCheckpoint, this, _1), "Loads the next checkpoint", PERMISSION_FREEPLAY);
 	cvarManager->registerNotifier("cpt_rand_checkpoint", std::bind(&CheckpointPlugin::randCheckpoint, this, _1), "Restores a random saved checkpoint", PERMISSION_FREEPLAY);
+	cvarManager->registerNotifier("cpt_nearest_checkpoint", std::bind(&CheckpointPlugin::nearestCheckpoint, this, _1), "Restores the saved checkpoint most like the current situation", PERMISSION_FREEPLAY);
+	cvarManager->registerNotifier("cpt_similar_moment", std::bind(&CheckpointPlugin::similarMoment, this, _1), "Rewinds to the moment in history most like the frozen state; repeat for the next", PERMISSION_FREEPLAY);
+	cvarManager->registerNotifier("cpt_prev_marker", std::bind(&CheckpointPlugin::prevMarker, this, _1), "Rewinds to the previous touch, jump, landing or boost; optionally only those named", PERMISSION_FREEPLAY);
+	cvarManager->registerNotifier("cpt_next_marker", std::bind(&CheckpointPlugin::nextMarker, this, _1), "Advances to the next touch, jump, landing or boost; optionally only those named", PERMISSION_FREEPLAY);
 	cvarManager->registerNotifier("cpt_delete_all", std::bind(&CheckpointPlugin::deleteAllCheckpoints, this, _1), "Deletes ALL checkpoints", PERMISSION_ALL);
 	cvarManager->registerNotifier("cpt_mirror_state", std::bind(&CheckpointPlugin::mirrorState, this, _1), "Mirrors the current frozen state", PERMISSION_FREEPLAY);
 	cvarManager->registerNotifier("cpt_freeze_ball", std::bind(&CheckpointPlugin::freezeBallUnfreezeCar, this, _1), "Freezes/unfreezes the ball", PERMISSION_FREEPLAY);
 	cvarManager->registerNotifier("cpt_copy", std::bind(&CheckpointPlugin::copyShot, this, _1), "Copies the frozen state / quick checkpoint / last checkpoint to the clipboard", PERMISSION_ALL);
 	cvarManager->registerNotifier("cpt_paste", std::bind(&CheckpointPlugin::pasteShot, this, _1), "Loads a checkpoint from the clipboard as a quick checkpoint", PERMISSION_FREEPLAY);
+	cvarManager->registerNotifier("cpt_rewind_session", std::bind(&CheckpointPlugin::rewindSession, this, _1), "Rewinds to <n> seconds ago in the recorded session", PERMISSION_FREEPLAY);
+	cvarManager->registerNotifier("cpt_restore_history", std::bind(&CheckpointPlugin::restoreHistory, this, _1), "Restores history saved before a crash", PERMISSION_FREEPLAY);
+	cvarManager->registerNotifier("cpt_profile_dump", std::bind(&CheckpointPlugin::dumpProfile, this, _1), "Writes the cpt_profile histograms to a CSV file", PERMISSION_ALL);
+	cvarManager->registerNotifier("cpt_events_dump", std::bind(&CheckpointPlugin::dumpEvents, this, _1), "Writes the recent debug events to a file", PERMISSION_ALL);
+	cvarManager->registerNotifier("cpt_export_history", std::bind(&CheckpointPlugin::exportHistory, this, _1), "Writes history and the inputs held for it to a CSV file", PERMISSION_ALL);
+	cvarManager->registerNotifier("cpt_stats", std::bind(&CheckpointPlugin::printStats, this, _1), "Prints the attempts, goals and touch times for each checkpoint", PERMISSION_ALL);
+	cvarManager->registerNotifier("cpt_shot_priority", std::bind(&CheckpointPlugin::shotPriority, this, _1), "Sets the current checkpoint's priority for cpt_weighted_loads, -3 to 3", PERMISSION_ALL);
+	cvarManager->registerNotifier("cpt_generate_variants", std::bind(&CheckpointPlugin::generateVariants, this, _1), "Writes <n> variants of the current checkpoint, with variance and mirroring, to <cpt_filename>.variants", PERMISSION_ALL);
 
 	// Add default bindings.
 	registerBindingCVars();
@@ -227,6 +352,48 @@ void CheckpointPlugin::onLoad()
 	writeSettingsFile();
 }
 
+// Derives the snapshot interval and history length from the history cvars.
+// If a memory budget is set and the requested history does not fit, snapshots
+// are taken less often (down to MAX_SNAPSHOT_INTERVAL) and then history is
+// shortened.
+void CheckpointPlugin::updateHistorySize() {
+	float interval = configuredInterval;
+	int entries = int(historyTime / interval);
+	if (historyBudgetMB > 0) {
+		int budgetEntries = int(size_t(historyBudgetMB) * 1024 * 1024 / sizeof(GameState));
+		if (entries > budgetEntries) {
+			interval = std::min(float(historyTime) / budgetEntries, MAX_SNAPSHOT_INTERVAL);
+			entries = std::min(int(historyTime / interval), budgetEntries);
+		}
+	}
+	if (interval != snapshotInterval) {
+		// History indices are only meaningful for a single interval.
+		snapshotInterval = interval;
+		rewinder.interval = interval;
+		rewinder.history.clear();
+		sessionRecorder.stop();
+		recovery.stop(true);
+		setFrozen(false, false);
+		rewinder.dodgeExpiration = 0.0;
+	}
+	if (entries != maxHistory) {
+		recovery.stop(true); // Restarted by record() with the new capacity.
+	}
+	maxHistory = entries;
+	// Allocate the whole buffer up front so recording never allocates.
+	rewinder.setCapacity(maxHistory);
+	updateMemoryUsage();
+}
+
+// Reports the memory held by history, checkpoints and the session buffer in
+// cpt_memory_usage_kb.
+void CheckpointPlugin::updateMemoryUsage() {
+	size_t bytes = (rewinder.history.capacity() + checkpoints.capacity()) * sizeof(GameState) +
+		rewinder.markers.capacity() * sizeof(Marker) + rewinder.inputs.capacity() * sizeof(uint64_t) + statsFile.size() +
+		locks.capacity() / 8 + sessionRecorder.memoryUsage() + rewinder.attempts.memoryUsage() + mirrors.memoryUsage();
+	cvarManager->getCvar("cpt_memory_usage_kb").setValue(int((bytes + 1023) / 1024));
+}
+
 bool CheckpointPlugin::enabled() {
 	if (gameWrapper->IsInReplay()) {
 		// Replays may be paused when checkpoints are taken.
@@ -264,12 +431,12 @@ void CheckpointPlugin::copyShot(std::vector<std::string> command) {
 			return;
 		}
 		output = gs->toString();
-	} else if (rewindMode) {
+	} else if (rewinder.rewindMode) {
 		cvarManager->log("Copying current position");
-		output = latest.toString();
-	} else if (hasQuickCheckpoint) {
+		output = rewinder.latest.toString();
+	} else if (rewinder.hasQuickCheckpoint) {
 		cvarManager->log("Copying quick checkpoint");
-		output = quickCheckpoint.toString();
+		output = rewinder.quickCheckpoint.toString();
 	} else if (checkpoints.size() > 0) {
 		cvarManager->log("Copying checkpoint " + std::to_string(curCheckpoint + 1));
 		output = checkpoints.at(curCheckpoint).toString();
@@ -324,43 +491,43 @@ void CheckpointPlugin::pasteShot(std::vector<std::string> command) {
 		cvarManager->log("Malformed checkpoint in clipboard: " + input);
 		return;
 	}
-	quickCheckpoint = GameState(input.substr(4, input.size() - 5));
-	loadGameState(quickCheckpoint);
-	hasQuickCheckpoint = true;
-	rewindState.justLoadedQuickCheckpoint = true;
+	rewinder.quickCheckpoint = GameState(input.substr(4, input.size() - 5));
+	loadGameState(rewinder.quickCheckpoint);
+	rewinder.hasQuickCheckpoint = true;
+	rewinder.rewindState.justLoadedQuickCheckpoint = true;
 }
 
 void CheckpointPlugin::freezeBallUnfreezeCar(std::vector<std::string> command) {
-	if (!enabledLoads() || history.size() == 0) {
+	if (!enabledLoads() || rewinder.history.size() == 0) {
 		return;
 	}
-	if (rewindMode) {
+	if (rewinder.rewindMode) {
 		setFrozen(false, true);
 		return;
 	}
-	if (freezeBall) {
+	if (rewinder.freezeBall) {
 		setFrozen(false, false);
-		latest.car = history.back().car;
-		latest.apply(gameWrapper, showBoost);
-		quickCheckpoint = latest;
-		hasQuickCheckpoint = true;
+		rewinder.latest.car = rewinder.history.back().car;
+		applyGame(rewinder.latest, gameWrapper, showBoost);
+		rewinder.quickCheckpoint = rewinder.latest;
+		rewinder.hasQuickCheckpoint = true;
 		return;
 	}
 	if (ignoreFreezeBall) {
 		return;
 	}
-	latest = history.back();
-	latest.apply(gameWrapper, false);
+	rewinder.latest = rewinder.history.back();
+	applyGame(rewinder.latest, gameWrapper, false);
 	setFrozen(false, true);
 }
 
 void CheckpointPlugin::mirrorState(std::vector<std::string> command) {
-	if (!enabledLoads() || !rewindMode) {
+	if (!enabledLoads() || !rewinder.rewindMode) {
 		return;
 	}
-	rewindState.atCheckpoint = false;
-	hasQuickCheckpoint = true;
-	quickCheckpoint = latest.mirror();
+	rewinder.rewindState.atCheckpoint = false;
+	rewinder.hasQuickCheckpoint = true;
+	rewinder.quickCheckpoint = rewinder.latest.mirror();
 	loadLatestCheckpoint();
 }
 
@@ -371,6 +538,8 @@ void CheckpointPlugin::deleteAllCheckpoints(std::vector<std::string> command) {
 	cvarManager->getCvar("cpt_allow_delete_all").setValue("0");
 	checkpoints.resize(0);
 	locks.resize(0);
+	checkpointIndex.clear();
+	mirrors.invalidate();
 	curCheckpoint = 0;
 	saveCheckpointFile();
 }
@@ -382,14 +551,170 @@ void CheckpointPlugin::randCheckpoint(std::vector<std::string> command) {
 	loadRandomCheckpoint();
 }
 
+// Loads the checkpoint nearest the frozen state, or the game if playing.
+void CheckpointPlugin::nearestCheckpoint(std::vector<std::string> command) {
+	if (!enabledLoads()) {
+		return;
+	}
+	ServerWrapper sw = gameWrapper->GetGameEventAsServer();
+	if (sw.IsNull() || sw.GetBall().IsNull() || sw.GetGameCar().IsNull()) {
+		return;
+	}
+	size_t nearest;
+	if (!checkpointIndex.nearest(rewinder.rewindMode ? rewinder.latest : captureGame(gameWrapper), nearest)) {
+		return;
+	}
+	rewinder.hasQuickCheckpoint = false;
+	curCheckpoint = nearest;
+	loadLatestCheckpoint();
+}
+
+// In rewind mode, moves to the moment in history most like the frozen state
+// or checkpoint.  Pressing again without scrubbing moves to the next most
+// similar, up to SIMILAR_MOMENTS.
+void CheckpointPlugin::similarMoment(std::vector<std::string> command) {
+	if (!enabled() || !rewinder.rewindMode || rewinder.history.empty()) {
+		return;
+	}
+	auto& rs = rewinder.rewindState;
+	if (similarMoments.empty() || rs.virtualTimeOffset != similarMomentOffset) {
+		size_t exclude = SIZE_MAX; // A checkpoint is not in history.
+		if (!rs.atCheckpoint && !rs.justLoadedQuickCheckpoint) {
+			exclude = rewinder.currentIndex();
+		}
+		historySearch.search(rewinder.history, rewinder.latest, SIMILAR_MOMENTS,
+			size_t(SIMILAR_SEPARATION / rewinder.interval), exclude, similarMoments);
+		nextSimilarMoment = 0;
+		if (similarMoments.empty()) {
+			return;
+		}
+	}
+	const HistoryMatch& m = similarMoments[nextSimilarMoment];
+	float ago = (rewinder.history.size() - m.index) * rewinder.interval;
+	events.trace(EVENT_SIMILAR_MOMENT, nextSimilarMoment + 1, similarMoments.size(), ago, m.distance);
+	nextSimilarMoment = (nextSimilarMoment + 1) % similarMoments.size();
+	rewinder.seek(m.index); // Applied on the next tick.
+	similarMomentOffset = rs.virtualTimeOffset;
+}
+
+// In rewind mode, moves to the previous or next touch, jump, landing or
+// boost in history; arguments limit it to those kinds (see markerKind()).
+void CheckpointPlugin::prevMarker(std::vector<std::string> command) {
+	seekMarker(command, false);
+}
+
+void CheckpointPlugin::nextMarker(std::vector<std::string> command) {
+	seekMarker(command, true);
+}
+
+void CheckpointPlugin::seekMarker(const std::vector<std::string>& command, bool forward) {
+	if (!enabled() || !rewinder.rewindMode || rewinder.history.empty()) {
+		return;
+	}
+	uint8_t kinds = command.size() > 1 ? 0 : MARK_ALL;
+	for (size_t i = 1; i < command.size(); i++) {
+		uint8_t kind = markerKind(command[i].c_str());
+		if (kind == 0) {
+			cvarManager->log("Unknown marker: " + command[i]);
+		}
+		kinds |= kind;
+	}
+	size_t index = rewinder.currentIndex();
+	if (rewinder.rewindState.atCheckpoint || rewinder.rewindState.justLoadedQuickCheckpoint) {
+		if (forward) {
+			return; // Not in history; only earlier moments are.
+		}
+		index = rewinder.history.size();
+	}
+	uint8_t found = forward ?
+		rewinder.markers.next(rewinder.history, index, kinds) :
+		rewinder.markers.previous(rewinder.history, index, kinds);
+	if (found == 0) {
+		return;
+	}
+	events.trace(EVENT_MARKER, found, (rewinder.history.size() - index) * rewinder.interval);
+	rewinder.seek(index); // Applied on the next tick.
+}
+
+// Refills history from the session recording, ending <n> seconds ago, and
+// enters rewind mode at that point.
+void CheckpointPlugin::rewindSession(std::vector<std::string> command) {
+	if (!enabledLoads()) {
+		return;
+	}
+	if (command.size() != 2) {
+		cvarManager->log("cpt_rewind_session: error: requires exactly 1 param.");
+		return;
+	}
+	if (!sessionRecorder.active() || sessionRecorder.size() == 0) {
+		cvarManager->log("cpt_rewind_session: no session recorded; set cpt_record_session.");
+		return;
+	}
+	size_t back = size_t(std::max(get_safe_float(command[1]), 0.0f) / sessionRecorder.interval());
+	size_t count = sessionRecorder.size();
+	if (back >= count) {
+		cvarManager->log("cpt_rewind_session: session has only " +
+			std::to_string(int(count * sessionRecorder.interval())) + " seconds saved.");
+		return;
+	}
+	size_t end = count - back;
+	size_t first = end > size_t(maxHistory) ? end - maxHistory : 0;
+	std::vector<GameState> loaded;
+	if (!sessionRecorder.read(first, end - first, loaded)) {
+		cvarManager->log("cpt_rewind_session: error reading session file.");
+		return;
+	}
+	rewinder.history.assign(loaded.begin(), loaded.end());
+	rewinder.latest = rewinder.history.back();
+	loadGameState(rewinder.latest);
+}
+
+// Restores history and the quick checkpoint saved by cpt_crash_recovery
+// before the plugin last exited without unloading.
+void CheckpointPlugin::restoreHistory(std::vector<std::string> command) {
+	if (!enabledLoads()) {
+		return;
+	}
+	auto path = gameWrapper->GetDataFolder() / RECOVERED_FILE_NAME;
+	float interval;
+	std::vector<GameState> restored;
+	bool hasQuick;
+	GameState quick;
+	if (!RecoveryWriter::load(path, interval, restored, hasQuick, quick)) {
+		cvarManager->log("cpt_restore_history: no history to restore.");
+		return;
+	}
+	if (interval != snapshotInterval) {
+		cvarManager->log("cpt_restore_history: history was saved with a different refresh rate.");
+		return;
+	}
+	if (restored.size() > maxHistory) {
+		restored.erase(restored.begin(), restored.begin() + restored.size() - maxHistory);
+	}
+	if (restored.size() > 0) {
+		rewinder.history.assign(restored.begin(), restored.end());
+		rewinder.latest = rewinder.history.back();
+		loadGameState(rewinder.latest);
+	} else if (hasQuick) {
+		loadGameState(quick);
+	}
+	if (hasQuick) {
+		rewinder.quickCheckpoint = quick;
+		rewinder.hasQuickCheckpoint = true;
+	}
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+	cvarManager->log("History restored.");
+}
+
 void CheckpointPlugin::prevCheckpoint(std::vector<std::string> command) {
 	if (!enabledLoads() || checkpoints.size() == 0) {
 		return;
 	}
-	if (ignorePrev && !rewindMode) {
+	if (ignorePrev && !rewinder.rewindMode) {
 		return;
 	}
-	if (!rewindState.justDeletedCheckpoint) {
+	if (!rewinder.rewindState.justDeletedCheckpoint) {
 		// If you just deleted a checkpoint, prev should go one prior to
 		// the deleted one (the current one).
 		if (curCheckpoint == 0) {
@@ -405,7 +730,7 @@ void CheckpointPlugin::nextCheckpoint(std::vector<std::string> command) {
 	if (!enabledLoads() || checkpoints.size() == 0) {
 		return;
 	}
-	if (ignoreNext && !rewindMode) {
+	if (ignoreNext && !rewinder.rewindMode) {
 		return;
 	}
 	curCheckpoint++;
@@ -416,17 +741,17 @@ void CheckpointPlugin::nextCheckpoint(std::vector<std::string> command) {
 }
 
 void CheckpointPlugin::lockCheckpoint(std::vector<std::string> command) {
-	if (gameWrapper->IsPaused() || !rewindMode || !rewindState.atCheckpoint) {
+	if (gameWrapper->IsPaused() || !rewinder.rewindMode || !rewinder.rewindState.atCheckpoint) {
 		return;
 	}
-	rewindState.deleting = false;
+	rewinder.rewindState.deleting = false;
 	if (locks.size() <= curCheckpoint) {
 		locks.resize(curCheckpoint + 1);
 	}
 	if (locks[curCheckpoint]) {
-		log("at cpt; unlocking: " + std::to_string(curCheckpoint + 1));
+		events.trace(EVENT_CHECKPOINT_UNLOCKED, curCheckpoint + 1);
 	} else {
-		log("at cpt; locking: " + std::to_string(curCheckpoint + 1));
+		events.trace(EVENT_CHECKPOINT_LOCKED, curCheckpoint + 1);
 	}
 	locks[curCheckpoint] = !locks[curCheckpoint];
 	saveCheckpointFile();
@@ -437,132 +762,190 @@ void CheckpointPlugin::doCheckpoint(std::vector<std::string> command) {
 		if (!enabled()) {
 			return;
 		}
+		traceCommands |= TRACE_DO_CHECKPOINT;
+
 		if (gameWrapper->IsInReplay()) {
 			std::unique_ptr<GameState> gs = getReplayGameState();
 			if (gs == nullptr) {
 				return;
 			}
 			cvarManager->log("adding checkpoint " + std::to_string(checkpoints.size() + 1));
+			checkpointIndex.add(checkpoints.size(), *gs);
 			checkpoints.push_back(*gs);
+			mirrors.inserted(checkpoints, checkpoints.size() - 1);
 			saveCheckpointFile();
 			return;
 		}
 		if (gameWrapper->IsInCustomTraining()) {
 			// Only support loading the quick checkpoint for now.
-			if (hasQuickCheckpoint) {
+			if (rewinder.hasQuickCheckpoint) {
 				loadLatestCheckpoint();
 			}
 			return;
 		}
-		if (!rewindMode) {
-			if (randomizeLoads) {
+		if (!rewinder.rewindMode) {
+			if (randomizeLoads || weightedLoads) {
 				loadRandomCheckpoint();
 				return;
 			}
 			loadLatestCheckpoint();
 			return;
 		}
-		hasQuickCheckpoint = false;
-		if (rewindState.atCheckpoint) { // Delete the current checkpoint we are at.
+		rewinder.hasQuickCheckpoint = false;
+		if (rewinder.rewindState.atCheckpoint) { // Delete the current checkpoint we are at.
 			if (locks.size() > curCheckpoint && locks[curCheckpoint]) {
-				log("at cpt but locked: " + std::to_string(curCheckpoint + 1));
+				events.trace(EVENT_REMOVE_LOCKED, curCheckpoint + 1);
 				return;
 			}
-			if (!rewindState.deleting) {
-				rewindState.deleting = true;
+			if (!rewinder.rewindState.deleting) {
+				rewinder.rewindState.deleting = true;
 				return;
 			}
-			rewindState.deleting = false;
-			log("at cpt; removing: " + std::to_string(curCheckpoint + 1));
+			rewinder.rewindState.deleting = false;
+			events.trace(EVENT_CHECKPOINT_REMOVED, curCheckpoint + 1);
 			checkpoints.erase(checkpoints.begin() + curCheckpoint);
+			checkpointIndex.remove(curCheckpoint);
+			mirrors.removed(checkpoints, curCheckpoint);
 			if (locks.size() > curCheckpoint) {
 				locks.erase(locks.begin() + curCheckpoint);
 			}
 			curCheckpoint = std::min(curCheckpoint, checkpoints.size() - 1);
-			rewindState.atCheckpoint = false;
-			rewindState.justDeletedCheckpoint = true;
+			rewinder.rewindState.atCheckpoint = false;
+			rewinder.rewindState.justDeletedCheckpoint = true;
 			saveCheckpointFile();
 			return;
 		}
 		// Add a new checkpoint here.
-		log("adding checkpoint " + std::to_string(checkpoints.size() + 1));
+		events.trace(EVENT_CHECKPOINT_ADDED, checkpoints.size() + 1);
 		curCheckpoint = checkpoints.size();
-		checkpoints.push_back(latest);
+		checkpointIndex.add(curCheckpoint, rewinder.latest);
+		checkpoints.push_back(rewinder.latest);
+		mirrors.inserted(checkpoints, curCheckpoint);
 		saveCheckpointFile();
-		loadGameState(latest);
-		rewindState.atCheckpoint = true;
+		loadGameState(rewinder.latest);
+		rewinder.rewindState.atCheckpoint = true;
 	}
 }
 
 void CheckpointPlugin::registerVarianceCVars() {
-	cvarManager->registerCvar("cpt_variance_car_dir", "0", "If set, randomly vary car's direction when resuming", true, true, 0, true, 30, true);
-	cvarManager->registerCvar("cpt_variance_car_spd", "0", "If set, randomly vary car's speed when resuming", true, true, 0, true, 50, true);
-	cvarManager->registerCvar("cpt_variance_car_rot", "0", "If set, randomly vary car's rotation when resuming", true, true, 0, true, 10, true);
-	cvarManager->registerCvar("cpt_variance_ball_dir", "0", "If set, randomly vary ball's direction when resuming", true, true, 0, true, 30, true);
-	cvarManager->registerCvar("cpt_variance_ball_spd", "0", "If set, randomly vary ball's speed when resuming", true, true, 0, true, 50, true);
-	cvarManager->registerCvar("cpt_variance_ball_rot", "0", "If set, randomly vary ball's rotation when resuming", true, true, 0, true, 10, true);
-	cvarManager->registerCvar("cpt_variance_tot", "0", "Total variance applied to all factors (range)", true, true, 0, true, 50, true);
+	// Values are cached since variance is applied on every tick while frozen.
+	auto cache = [](CVarWrapper cv, float* var) {
+		cv.addOnValueChanged([var](std::string old, CVarWrapper now) {
+			*var = now.getFloatValue();
+		});
+		cv.notify();
+	};
+	cache(cvarManager->registerCvar("cpt_variance_car_dir", "0", "If set, randomly vary car's direction when resuming", true, true, 0, true, 30, true), &variance.carDir);
+	cache(cvarManager->registerCvar("cpt_variance_car_spd", "0", "If set, randomly vary car's speed when resuming", true, true, 0, true, 50, true), &variance.carSpd);
+	cache(cvarManager->registerCvar("cpt_variance_car_rot", "0", "If set, randomly vary car's rotation when resuming", true, true, 0, true, 10, true), &variance.carRot);
+	cache(cvarManager->registerCvar("cpt_variance_ball_dir", "0", "If set, randomly vary ball's direction when resuming", true, true, 0, true, 30, true), &variance.ballDir);
+	cache(cvarManager->registerCvar("cpt_variance_ball_spd", "0", "If set, randomly vary ball's speed when resuming", true, true, 0, true, 50, true), &variance.ballSpd);
+	cache(cvarManager->registerCvar("cpt_variance_ball_rot", "0", "If set, randomly vary ball's rotation when resuming", true, true, 0, true, 10, true), &variance.ballRot);
+	cache(cvarManager->registerCvar("cpt_variance_tot", "0", "Total variance applied to all factors (range)", true, true, 0, true, 50, true), &variance.tot);
+
+	auto seedCV = cvarManager->registerCvar(
+		"cpt_seed", "0", "Seeds variance, mirrored loads and random loads so drills repeat; 0 picks a new seed each session", true, true, 0, true, 2147483647, true);
+	seedCV.addOnValueChanged([this](std::string old, CVarWrapper now) {
+		reseed(uint64_t(now.getIntValue()));
+	});
+	seedCV.notify();
 }
 
 void CheckpointPlugin::onUnload() {
+	// Queued behind the last snapshots; stop() drains the ring before joining.
+	sessionRecorder.stop();
+	recovery.stop(true);
+	pipeline.stop();
+	stats.detach();
+	statsFile.flush();
+	statsFile.close();
 }
 
 void CheckpointPlugin::loadLatestCheckpoint() {
-	if (hasQuickCheckpoint) {
-		log("loading quick checkpoint");
-		loadGameState(quickCheckpoint);
-		hasQuickCheckpoint = true;
-		rewindState.justLoadedQuickCheckpoint = true;
+	if (rewinder.hasQuickCheckpoint) {
+		events.trace(EVENT_LOAD_QUICK_CHECKPOINT);
+		loadGameState(rewinder.quickCheckpoint);
+		rewinder.hasQuickCheckpoint = true;
+		rewinder.rewindState.justLoadedQuickCheckpoint = true;
 		return;
 	}
 	if (checkpoints.size() > 0) {
-		log("loading checkpoint " + std::to_string(curCheckpoint+1));
+		events.trace(EVENT_LOAD_CHECKPOINT, curCheckpoint + 1);
 		loadCurCheckpoint();
 		return;
 	}
-	log("no checkpoint to load");
-	rewindState.virtualTimeOffset = 0;
-	rewindState.holdingFor = 0;
+	events.trace(EVENT_NO_CHECKPOINT);
+	rewinder.rewindState.virtualTimeOffset = 0;
+	rewinder.rewindState.holdingFor = 0;
 }
 
 void CheckpointPlugin::loadRandomCheckpoint() {
 	if (checkpoints.size() == 0) {
 		return;
 	}
-	hasQuickCheckpoint = false;
-	curCheckpoint = rand() % checkpoints.size();
+	rewinder.hasQuickCheckpoint = false;
+	if (weightedLoads) {
+		curCheckpoint = scheduler.next(checkpoints, stats, loadRng.unit());
+	} else {
+		curCheckpoint = size_t(loadRng.below(checkpoints.size()));
+	}
 	loadLatestCheckpoint();
 }
 
 void CheckpointPlugin::loadCurCheckpoint() {
-	auto checkpoint = checkpoints.at(curCheckpoint);
-	if (mirrorLoads && rand() % 2 == 0) {
-		checkpoint = checkpoint.mirror();
-	}
-	loadGameState(checkpoint);
-	rewindState.atCheckpoint = true;
+	const GameState& checkpoint = checkpoints.at(curCheckpoint);
+	uint64_t key = checkpoint.hash();
+	// Both drawn on every load, so cpt_mirror_loads does not shift the variance.
+	Rng& drill = drillRng(key);
+	varianceRng.reseed(drill.next());
+	bool mirror = drill.below(2) == 0;
+	loadGameState(mirrorLoads && mirror ? mirrors.mirrored(checkpoints, curCheckpoint) : checkpoint, key);
+	rewinder.rewindState.atCheckpoint = true;
 }
 
-void CheckpointPlugin::loadGameState(const GameState& state) {
-	latest = state;
+void CheckpointPlugin::loadGameState(const GameState& state, uint64_t checkpoint) {
+	rewinder.load(state, checkpoint);
 	ServerWrapper sw = gameWrapper->GetGameEventAsServer();
-	if (cvarManager->getCvar("sv_soccar_enablegoal").getBoolValue()) {
+	if (!enableGoalCV.IsNull() && enableGoalCV.getBoolValue()) {
 		sw.PlayerResetTraining(); // In case a goal was just scored, there may be no ball.
 	}
-	latest.apply(gameWrapper, false);
-	rewindState.virtualTimeOffset = 0;
-	rewindState.holdingFor = 0;
+	applyGame(rewinder.latest, gameWrapper, false);
 	setFrozen(true, true);
-	rewindState.atCheckpoint = false;
-	hasQuickCheckpoint = false;
-	rewindState.justDeletedCheckpoint = false;
-	rewindState.justLoadedQuickCheckpoint = false;
-	rewindState.deleting = false;
-	rewindState.buttonsDown = 0x7f;
-	playingFromCheckpoint = true; // not playing yet but must resume eventually.
 }
 
+// Ticks after entering or leaving rewind mode before allocations are unexpected.
+constexpr uint64_t ALLOCATION_WARMUP_TICKS = 120;
+
 void CheckpointPlugin::OnPreAsync(std::string funcName)
+{
+	collectCheckpointMeta();
+	uint64_t allocations = allocationCount();
+	{
+		ScopedTimer timer(profiler, PROFILE_TICK);
+		tick();
+	}
+	tickAllocations = allocationCount() - allocations;
+	if (profiler.enabled) {
+		profiler.tickAllocations.add(tickAllocations);
+	}
+	// After counting, since formatting allocates.
+	if (printedEvents != events.count()) {
+		printEvents();
+	}
+	if (rewinder.statsFull && !statsFullLogged) {
+		statsFullLogged = true;
+		cvarManager->log("error: the stats file is full or could not be grown; attempts are not being counted.");
+	}
+	if (rewinder.rewindMode != lastTickRewinding) {
+		lastTickRewinding = rewinder.rewindMode;
+		steadyTicks = 0;
+	} else if (++steadyTicks > ALLOCATION_WARMUP_TICKS && tickAllocations > 0) {
+		steadyAllocatingTicks++;
+	}
+}
+
+// Must not allocate once history is full; see tickAllocations.
+void CheckpointPlugin::tick()
 {
 	if (!gameWrapper->IsInFreeplay() && !gameWrapper->IsInCustomTraining()) {
 		return;
@@ -571,192 +954,200 @@ void CheckpointPlugin::OnPreAsync(std::string funcName)
 	if (sw.GetBall().IsNull() || sw.GetGameCar().IsNull()) {
 		return;
 	}
+	if (recordTrace) {
+		traceTick(sw);
+	}
 
-	if (rewindMode) {
-		if (rewind(sw)) {
-			applyVariance(latest).apply(gameWrapper, showBoost);
+	if (rewinder.rewindMode) {
+		ControllerInput ci = sw.GetCars().Get(0).GetInput();
+		bool apply;
+		{
+			ScopedTimer timer(profiler, PROFILE_REWIND);
+			apply = rewinder.rewind(*this, sw.GetSecondsElapsed(), toRewindInput(ci));
 		}
-	} else {
-		record(sw);
-	}
-}
-
-// Returns true if we need to apply the state again.
-bool CheckpointPlugin::rewind(ServerWrapper sw) {
-	ControllerInput ci = sw.GetCars().Get(0).GetInput();
-
-	float currentTime = sw.GetSecondsElapsed();
-	float elapsed = std::min(currentTime - lastRewindTime, 0.03f);
-	if (elapsed < 0) {
-		lastRewindTime = currentTime;
-		return false;  // Ignored whatever inputs may have happened to exit mode; do not apply state.
-	}
-	if (elapsed < 0.01f) {
-		return false;  // Ignored whatever inputs may have happened to exit mode; do not apply state.
-	}
-	lastRewindTime = currentTime;
-	int buttonsDown = (abs(ci.Throttle) > 0.1 ? 0x01 : 0) |
-		(abs(ci.Roll) > 0.1 ? 0x02 : 0) |
-		(ci.Handbrake ? 0x04 : 0) |
-		(ci.Jump ? 0x08 : 0) |
-		(ci.ActivateBoost ? 0x10 : 0) |
-		(ci.HoldingBoost ? 0x20 : 0) |
-		((rewindState.atCheckpoint || rewindState.justLoadedQuickCheckpoint) && abs(ci.Steer) >= .05 ? 0x40 : 0) |
-		((rewindState.atCheckpoint || rewindState.justLoadedQuickCheckpoint || abs(ci.Pitch) >= .7) && abs(ci.Pitch) >= .05 ? 0x80 : 0);
-	// See if we should exit rewind mode due to input.
-	if (buttonsDown != 0) {
-		if ((buttonsDown > rewindState.buttonsDown && currentTime - lastRecordTime > 0.1f) ||
-			currentTime - lastRecordTime > 0.5f) {
-			log("resuming...");
-			setFrozen(false, false);
-			lastRecordTime = currentTime;
-			dodgeExpiration = (latest.car.hasDodge && latest.car.lastJumped != -1) ? (currentTime + MAX_DODGE_TIME - latest.car.lastJumped) : 0;
-			if (!rewindState.atCheckpoint) {
-				log("quick checkpoint taken");
-				hasQuickCheckpoint = true;
-				quickCheckpoint = latest;
-				if (deleteFutureHistory) {
-					size_t current = std::clamp<size_t>(
-						history.size() - 1 + size_t(ceil(rewindState.virtualTimeOffset / snapshotInterval)),
-						0, history.size() - 1);
-					history.erase(history.begin() + current, history.end());
-				}
+		if (apply) {
+			{
+				ScopedTimer timer(profiler, PROFILE_VARIANCE);
+				applyVariance(rewinder.latest, varied);
 			}
-			return false; // Leaving rewind; do not apply state.
+			ScopedTimer timer(profiler, PROFILE_APPLY);
+			applyGame(varied, gameWrapper, showBoost);
 		}
-		rewindState.buttonsDown = buttonsDown;
-		return true; // Staying in rewind; apply state.
-	}
-	rewindState.buttonsDown = buttonsDown;
-
-	// Determine how much to rewind / advance time.
-	if (abs(ci.Steer) < .05f) { // Ignore slight input; keep current game state.
-		return true; // Ignoring input; apply state.
-	}
-	rewindState.deleting = false;
-	if (ci.Steer < -.95 && rewindState.holdingFor <= 0) {
-		rewindState.holdingFor -= elapsed;
-	} else if (ci.Steer > .95 && rewindState.holdingFor >= 0) {
-		rewindState.holdingFor += elapsed;
 	} else {
-		rewindState.holdingFor = 0;
-	}
-	float factor = std::clamp(abs(rewindState.holdingFor) * 2, 1.0f, 10.0f);
-
-	// How much (in seconds) to move "current" (positive or negative)
-	float deltaElapsed = factor * elapsed * ci.Steer; // full left = 2-5 seconds/second
-
-	rewindState.virtualTimeOffset = std::clamp(
-		rewindState.virtualTimeOffset + deltaElapsed, -snapshotInterval * history.size(), .0f);
-	float historyOffset = rewindState.virtualTimeOffset / snapshotInterval;
-	size_t current = std::clamp<size_t>(
-		history.size() + size_t(floor(historyOffset)), 0, history.size() - 1);
-	if (current < (history.size() - 1) /* && NEED TO INTERPOLATE */) {
-		float advancePct = 1 - (historyOffset - floor(historyOffset));
-		latest = GameState(history.at(current), history.at(current+1), advancePct);
-		return true; // Apply new state.
+		ScopedTimer timer(profiler, PROFILE_RECORD);
+		rewinder.record(*this, sw.GetSecondsElapsed());
 	}
-	latest = history.at(current);
-	return true; // Apply new state.
 }
 
-void CheckpointPlugin::record(ServerWrapper sw)
-{
-	float currentTime = sw.GetSecondsElapsed();
-	float elapsed = currentTime - lastRecordTime;
-	if (elapsed < 0) {
-		elapsed = snapshotInterval;
-	}
-	if (elapsed < snapshotInterval) {
-		return;
-	}
-	// This cannot be event-based since goals may be disabled.
-	if (playingFromCheckpoint && (resetOnGoal || resetOnBallGround)) {
-		auto ball = sw.GetBall();
-		if (ball.IsNull()) {
+// Called by the Rewinder when the ball scores or lands while playing from a
+// checkpoint.
+void CheckpointPlugin::resetShot() {
+	if (nextInsteadOfReset && !rewinder.hasQuickCheckpoint && checkpoints.size() > 0) {
+		if (randomizeLoads || weightedLoads) {
+			loadRandomCheckpoint();
 			return;
 		}
-		auto ballLoc = ball.GetLocation();
-		auto ballRad = ball.GetRadius();
-		if ((resetOnGoal && sw.IsInGoal(ballLoc)) ||
-			(resetOnBallGround && ballLoc.Z < ballRad + 5)) {
-			if (nextInsteadOfReset && !hasQuickCheckpoint && checkpoints.size() > 0) {
-				if (randomizeLoads) {
-					loadRandomCheckpoint();
-					return;
-				}
-				curCheckpoint++;
-				if (curCheckpoint == checkpoints.size()) {
-					curCheckpoint = 0;
-				}
-				loadCurCheckpoint();
-				return;
-			}
-			loadLatestCheckpoint();
-			return;
+		curCheckpoint++;
+		if (curCheckpoint == checkpoints.size()) {
+			curCheckpoint = 0;
 		}
+		loadCurCheckpoint();
+		return;
 	}
+	loadLatestCheckpoint();
+}
 
-	lastRecordTime = currentTime;
-	if (dodgeExpiration != 0) {
-		// If the timer expires or if the player double-jumps or gets a reset,
-		// clear the jump timer so we don't take the player's dodge.
-		auto c = sw.GetGameCar();
-		if (c && (currentTime > dodgeExpiration ||
-				  c.GetbDoubleJumped() ||
-				  c.GetNumWheelContacts() == 4)) {
-			c.SetbJumped(true);
-			c.SetbDoubleJumped(true);
-			dodgeExpiration = 0;
+// Called by the Rewinder with each snapshot added to history.
+void CheckpointPlugin::recorded(const GameState& s, float time) {
+	if (recordSession && !sessionRecorder.active()) {
+		sessionRecorder.start(snapshotInterval);
+		updateMemoryUsage();
+	}
+	if (crashRecovery) {
+		if (!recovery.active()) {
+			recovery.start(snapshotInterval, maxHistory);
+		}
+		// Saved with the next periodic write; no need to do this every snapshot.
+		if (time - lastRecoveryUpdate >= 1.0f || time < lastRecoveryUpdate) {
+			lastRecoveryUpdate = time;
+			recovery.setQuickCheckpoint(rewinder.hasQuickCheckpoint, rewinder.quickCheckpoint);
 		}
 	}
 
-	if (freezeBall) {
-		latest.ball.apply(sw.GetBall());
-	}
+	// Everything else happens on the pipeline thread.
+	pipeline.push({ s, time });
+}
 
-	// TODO: use a ring buffer?
-	if (history.size() == maxHistory) {
-		history.erase(history.begin());
-	}
-	if (dodgeExpiration == 0) {
-		history.emplace_back(gameWrapper);
-	} else {
-		history.emplace_back(gameWrapper, MAX_DODGE_TIME - currentTime + dodgeExpiration);
-	}
+// Appends this tick's inputs to the trace file for bench/replay.cpp.
+void CheckpointPlugin::traceTick(ServerWrapper sw) {
+	if (!traceFile.is_open()) {
+		traceFile.open(gameWrapper->GetDataFolder() / TRACE_FILE_NAME, std::ios::binary | std::ios::out | std::ios::trunc);
+		writeTraceHeader(traceFile);
+	}
+	auto ball = sw.GetBall();
+	auto car = sw.GetGameCar();
+	TraceTick t;
+	t.time = sw.GetSecondsElapsed();
+	t.input = toRewindInput(sw.GetCars().Get(0).GetInput());
+	t.state = captureGame(gameWrapper);
+	t.ballRadius = ball.GetRadius();
+	t.inGoal = sw.IsInGoal(ball.GetLocation());
+	t.doubleJumped = car.GetbDoubleJumped();
+	t.wheelContacts = uint8_t(car.GetNumWheelContacts());
+	t.touched = traceTouched;
+	t.commands = traceCommands;
+	traceCommands = 0;
+	traceTouched = false;
+
+	writeTraceTick(traceFile, t);
 }
 
-void show(CanvasWrapper canvas, Vector2 *loc, std::string s) {
+void show(CanvasWrapper canvas, Vector2 *loc, const char* s) {
 	static const float scale = 1.5f;
 	canvas.SetPosition(*loc);
 	canvas.DrawString(s, scale, scale);
 	loc->Y += 20;
 }
 
+// Formats a line of the debug overlay on the stack; the only copy left is the
+// std::string DrawString() takes.
+template<typename... Args>
+static void show(CanvasWrapper canvas, Vector2 *loc, const char* format, const Args&... args) {
+	char line[192];
+	*fmt::format_to_n(line, sizeof(line) - 1, format, args...).out = '\0';
+	show(canvas, loc, line);
+}
+
+// A checkpoint's stats on one line, for cpt_stats and the debug overlay.
+static void formatStats(const CheckpointStats& s, char* line, size_t size) {
+	char* out = line;
+	char* end = line + size - 1;
+	out = fmt::format_to_n(out, end - out, "{} attempts, {} goals", s.attempts, s.goals).out;
+	if (s.goals > 0) {
+		out = fmt::format_to_n(out, end - out, " (soonest {:.2f} s, ball at {:.0f} uu/s on average, {:.0f} fastest)",
+			s.bestGoalTime, s.goalSpeedTotal / s.goals, s.bestGoalSpeed).out;
+	}
+	if (s.touches > 0) {
+		out = fmt::format_to_n(out, end - out, ", first touch after {:.2f} s on average ({:.2f} soonest)",
+			s.touchTimeTotal / s.touches, s.bestTouchTime).out;
+	}
+	*out = '\0';
+}
+
 void CheckpointPlugin::Render(CanvasWrapper canvas) {
+	ScopedTimer timer(profiler, PROFILE_RENDER);
 	if (!enabled()) {
 		return;
 	}
+	if (profiler.enabled) {
+		renderProfile(canvas);
+	}
 	if (debug) {
 		canvas.SetColor('\xff', '\xff', '\xff', '\xdc');
 		auto screenSize = canvas.GetSize();
 		Vector2 loc = { (int)(screenSize.X * 0.08), (int)(screenSize.Y * 0.08) };
-		show(canvas, &loc, "rewindMode: " + std::to_string(rewindMode));
-		show(canvas, &loc, "atCheckpoint: " + std::to_string(rewindState.atCheckpoint));
-		show(canvas, &loc, "justDeletedCheckpoint: " + std::to_string(rewindState.justDeletedCheckpoint));
-		show(canvas, &loc, "justLoadedQuickCheckpoint: " + std::to_string(rewindState.justLoadedQuickCheckpoint));
-		show(canvas, &loc, "hasQuickCheckpoint: " + std::to_string(hasQuickCheckpoint));
-		show(canvas, &loc, "virtualTimeOffset: " + std::to_string(rewindState.virtualTimeOffset));
-		show(canvas, &loc, "buttonsDown: " + std::to_string(rewindState.buttonsDown));
+		show(canvas, &loc, "rewindMode: {}", int(rewinder.rewindMode));
+		show(canvas, &loc, "atCheckpoint: {}", int(rewinder.rewindState.atCheckpoint));
+		show(canvas, &loc, "justDeletedCheckpoint: {}", int(rewinder.rewindState.justDeletedCheckpoint));
+		show(canvas, &loc, "justLoadedQuickCheckpoint: {}", int(rewinder.rewindState.justLoadedQuickCheckpoint));
+		show(canvas, &loc, "hasQuickCheckpoint: {}", int(rewinder.hasQuickCheckpoint));
+		show(canvas, &loc, "virtualTimeOffset: {:f}", rewinder.rewindState.virtualTimeOffset);
+		show(canvas, &loc, "buttonsDown: {}", rewinder.rewindState.buttonsDown);
 		size_t current = std::clamp<size_t>(
-			history.size() + size_t(ceil(rewindState.virtualTimeOffset / snapshotInterval)),
-			0, history.size() - 1);
-		show(canvas, &loc, "current: " + std::to_string(current));
+			rewinder.history.size() + size_t(ceil(rewinder.rewindState.virtualTimeOffset / snapshotInterval)),
+			0, rewinder.history.size() - 1);
+		show(canvas, &loc, "current: {}", current);
+		show(canvas, &loc, "future: {}", rewinder.future.size());
+		RewindInput in;
+		if (rewinder.rewindMode && rewinder.inputs.at(rewinder.history, rewinder.currentIndex(), in)) {
+			show(canvas, &loc, "input: throttle {:.2f} steer {:.2f} pitch {:.2f} yaw {:.2f} roll {:.2f}{}{}{}",
+				in.throttle, in.steer, in.pitch, in.yaw, in.roll,
+				in.jump ? " jump" : "", in.holdingBoost ? " boost" : "", in.handbrake ? " handbrake" : "");
+		}
+		show(canvas, &loc, "input runs: {} for {} snapshots", rewinder.inputs.runs(), rewinder.history.size());
+		if (rewinder.attempts.size() > 0) {
+			const Attempt& a = rewinder.attempts[rewinder.attempts.size() - 1];
+			show(canvas, &loc, "attempts: {} kept, {} at the last checkpoint; last {:.2f} s{}",
+				rewinder.attempts.size(), rewinder.attempts.countFor(a.checkpoint), a.samples * a.interval,
+				rewinder.attempts.recording() ? " (recording)" : "");
+		}
+		if (curCheckpoint < checkpoints.size()) {
+			const CheckpointStats* s = stats.find(checkpoints[curCheckpoint].hash());
+			char line[160] = "no attempts";
+			if (s != nullptr) {
+				formatStats(*s, line, sizeof(line));
+			}
+			show(canvas, &loc, "stats: {}", line);
+			if (weightedLoads) {
+				show(canvas, &loc, "chance of being loaded next: {:.1f}%", scheduler.chance(curCheckpoint) * 100);
+			}
+		}
+		show(canvas, &loc, "seed: {} ({} drill streams)", seed, drillRngs.size());
+		show(canvas, &loc, "mirrors: {} of {} computed", mirrors.computed(), checkpoints.size());
+		if (ghost.active) {
+			show(canvas, &loc, "ghost: attempt {}, goal at {:.2f} s", ghost.number, ghost.goalTime);
+		}
+		show(canvas, &loc, "allocations: {} this tick, {} ticks after warm-up", tickAllocations, steadyAllocatingTicks);
+		show(canvas, &loc, "pipeline depth: {} (peak {}), drops: {}", pipeline.depth(), pipeline.peakDepth(), pipeline.drops());
+		if (curCheckpoint < checkpointMeta.size()) {
+			auto& m = checkpointMeta[curCheckpoint];
+			show(canvas, &loc, "checkpoint {}: zone {} side {} dodge {}", curCheckpoint + 1, m.zone, m.side, m.hasDodge);
+			show(canvas, &loc, "  ball {:.0f} up {:.0f} uu/s, car {:.0f} uu/s, {:.2f} s to ball",
+				m.ballHeight, m.ballSpeed, m.carSpeed, m.timeToBall);
+			if (m.lands) {
+				show(canvas, &loc, "  lands in {:.2f} s at ({:.0f}, {:.0f})", m.landTime, m.landX, m.landY);
+			}
+		}
+	}
+
+	if (ghostMode != GHOST_OFF && !rewinder.rewindMode) {
+		renderGhost(canvas);
 	}
-	if (!rewindMode) {
+
+	if (!rewinder.rewindMode) {
 		return;
 	}
-	if (rewindState.deleting) {
+	if (rewinder.rewindState.deleting) {
 		auto screenSize = canvas.GetSize();
 		Vector2 loc = { (int)(screenSize.X * 0.80), (int)(screenSize.Y * 0.08) };
 		loc.X = int(screenSize.X * .70);
@@ -765,7 +1156,7 @@ void CheckpointPlugin::Render(CanvasWrapper canvas) {
 		canvas.DrawString("Press again to delete...", 5, 5);
 		return;
 	}
-	if (rewindState.justDeletedCheckpoint) {
+	if (rewinder.rewindState.justDeletedCheckpoint) {
 		auto screenSize = canvas.GetSize();
 		Vector2 loc = { (int)(screenSize.X * 0.80), (int)(screenSize.Y * 0.08) };
 		loc.X = int(screenSize.X * .70);
@@ -774,68 +1165,293 @@ void CheckpointPlugin::Render(CanvasWrapper canvas) {
 		canvas.DrawString("Checkpoint deleted!", 5, 5);
 		return;
 	}
-	if (rewindState.atCheckpoint) {
+	if (rewinder.rewindState.atCheckpoint) {
 		auto screenSize = canvas.GetSize();
-		std::string l = "";
-		if (locks.size() > curCheckpoint && locks[curCheckpoint]) {
-			l = " (L)";
-		}
+		bool locked = locks.size() > curCheckpoint && locks[curCheckpoint];
+		// Formatted in place; short enough to avoid a heap allocation for the std::string.
+		char label[32];
+		snprintf(label, sizeof(label), "%zu | %zu%s", curCheckpoint + 1, checkpoints.size(), locked ? " (L)" : "");
 		Vector2 loc = { (int)(screenSize.X * 0.80), (int)(screenSize.Y * 0.08) };
 		canvas.SetPosition(loc + Vector2{ 5,5 });
 		canvas.SetColor(0, 0, 0, 100);
-		canvas.DrawString(std::to_string(curCheckpoint + 1) +
-			" | " +
-			std::to_string(checkpoints.size()) + l, 6, 6);
+		canvas.DrawString(label, 6, 6);
 		canvas.SetPosition(loc);
 		canvas.SetColor('\xff', '\xff', '\xff', '\xdc');
-		canvas.DrawString(std::to_string(curCheckpoint + 1) +
-			" | " +
-			std::to_string(checkpoints.size()) + l, 6, 6);
+		canvas.DrawString(label, 6, 6);
 	}
 }
 
-// Prevent loading an unknown version's save file.
-constexpr uint32_t SAVE_FILE_VERSION = 1;
-
 void CheckpointPlugin::loadCheckpointFile() {
-	checkpoints.clear();
-	locks.clear();
 	std::ifstream in(gameWrapper->GetDataFolder() / cvarManager->getCvar("cpt_filename").getStringValue(), std::ios::binary);
 	uint32_t version;
-	readPOD(in, version);
-	if (version != SAVE_FILE_VERSION) {
-		in.close();
-		log("could not load save file with version " + std::to_string(version));
-		return;
-	}
-	int32_t numSaves;
-	readPOD(in, numSaves);
-	for (int32_t i = 0; i < numSaves; i++) {
-		checkpoints.emplace_back(in);
-	}
-	int32_t numLocks = 0; // older save files did not have this data; initialize to 0.
-	readPOD(in, numLocks);
-	for (int32_t i = 0; i < numLocks; i++) {
-		bool locked;
-		readPOD(in, locked);
-		locks.push_back(locked);
+	if (!readCheckpointFile(in, checkpoints, locks, version)) {
+		events.trace(EVENT_BAD_SAVE_VERSION, version);
 	}
 	in.close();
+	checkpointIndex.build(checkpoints);
+	mirrors.invalidate();
+	updateCheckpointMeta(true, false);
+	scheduler.invalidate();
+	openStats();
+	updateMemoryUsage();
 }
 
 void CheckpointPlugin::saveCheckpointFile() {
+	ScopedTimer timer(profiler, PROFILE_SAVE);
+
 	std::ofstream out(gameWrapper->GetDataFolder() / cvarManager->getCvar("cpt_filename").getStringValue(), std::ios::binary | std::ios::out | std::ios::trunc);
-	auto ver = SAVE_FILE_VERSION;
-	writePOD(out, ver);
-	auto size = int32_t(checkpoints.size());
-	writePOD(out, size);
-	for (auto& fav : checkpoints) {
-		fav.write(out);
-	}
-	size = int32_t(locks.size());
-	writePOD(out, size);
-	for (bool l : locks) {
-		writePOD(out, l);
+	writeCheckpointFile(out, checkpoints, locks);
+	out.close();
+	updateCheckpointMeta(false, true);
+	scheduler.invalidate();
+	if (stats.attached() && StatsTable::slotsFor(checkpoints.size()) > stats.capacity()) {
+		openStats();
+	}
+	updateMemoryUsage();
+}
+
+// Opens <cpt_filename>.stats, kept open and updated in place as attempts end.
+// The table is sized for the library and rebuilt with only the current
+// checkpoints' entries, so deleted checkpoints give their slots back.
+void CheckpointPlugin::openStats() {
+	stats.detach();
+	rewinder.statsFull = false;
+	statsFullLogged = false;
+	if (!statsFile.open(
+		gameWrapper->GetDataFolder() / (cvarManager->getCvar("cpt_filename").getStringValue() + std::string(STATS_FILE_SUFFIX)),
+		StatsTable::bytesFor(StatsTable::slotsFor(checkpoints.size())), false)) {
+		return;
+	}
+	std::vector<char> old(statsFile.data(), statsFile.data() + statsFile.size());
+	StatsTable from;
+	from.attach(old.data(), old.size());
+	std::vector<uint64_t> hashes;
+	hashes.reserve(checkpoints.size());
+	for (const GameState& s : checkpoints) {
+		hashes.push_back(s.hash());
+	}
+	stats.format(statsFile.data(), statsFile.size());
+	rewinder.statsFull = !stats.copyFrom(from, hashes);
+	statsFile.flush();
+}
+
+// Queues checkpointMeta for an update on the meta worker, which computes
+// metadata for new checkpoints on all cores and saves the cache if anything
+// changed (or if write is set; reload reads it first).  Mirrors are computed
+// there too while cpt_mirror_loads is set, so loads rarely compute one.  Only
+// states the worker has not seen are copied; a reload sends them all again,
+// since the worker's cache is replaced by the file's.
+void CheckpointPlugin::updateCheckpointMeta(bool reload, bool write) {
+	MetaWorker::Job job;
+	if (reload) {
+		metaSent.clear();
+	}
+	job.keys.reserve(checkpoints.size());
+	for (const GameState& s : checkpoints) {
+		uint64_t key = s.hash();
+		job.keys.push_back(key);
+		if (metaSent.insert(key).second) {
+			job.states.push_back(s);
+		}
+	}
+	job.path = gameWrapper->GetDataFolder() / (cvarManager->getCvar("cpt_filename").getStringValue() + std::string(META_FILE_SUFFIX));
+	job.reload = reload;
+	job.write = write;
+	if (mirrorLoads) {
+		job.mirrors = mirrors.missing(checkpoints);
+		job.unmirrored.reserve(job.mirrors.size());
+		for (size_t i : job.mirrors) {
+			job.unmirrored.push_back(checkpoints[i]);
+		}
 	}
+	metaWorker.submit(std::move(job));
+	checkpointMeta.clear(); // Until the worker is done.
+}
+
+// Takes the meta worker's results once it has caught up with the checkpoints.
+void CheckpointPlugin::collectCheckpointMeta() {
+	MetaWorker::Result r;
+	if (!metaWorker.poll(r)) {
+		return;
+	}
+	checkpointMeta = std::move(r.meta);
+	mirrors.adopt(checkpoints, r.indices, r.mirrors);
+}
+
+// Shows p50/p99/max latency per profiled stage, and allocations per tick.
+void CheckpointPlugin::renderProfile(CanvasWrapper canvas) {
+	canvas.SetColor('\xff', '\xff', '\xff', '\xdc');
+	auto screenSize = canvas.GetSize();
+	Vector2 loc = { (int)(screenSize.X * 0.40), (int)(screenSize.Y * 0.08) };
+	char line[96];
+	show(canvas, &loc, "stage (us)        p50      p99      max");
+	for (int i = 0; i < PROFILE_STAGES; i++) {
+		auto& h = profiler.stages[i];
+		snprintf(line, sizeof(line), "%-12s %8.1f %8.1f %8.1f", profileStageName(ProfileStage(i)),
+			h.percentile(0.5) / 1000, h.percentile(0.99) / 1000, h.max() / 1000.0);
+		show(canvas, &loc, line);
+	}
+	auto& a = profiler.tickAllocations;
+	snprintf(line, sizeof(line), "%-12s %8.1f %8.1f %8llu", "allocs/tick",
+		a.percentile(0.5), a.percentile(0.99), (unsigned long long)a.max());
+	show(canvas, &loc, line);
+}
+
+// Outlines the car of an earlier attempt at the checkpoint being played, as
+// far into its attempt as the player is into theirs.
+void CheckpointPlugin::renderGhost(CanvasWrapper canvas) {
+	if (!rewinder.attempts.recording()) {
+		return;
+	}
+	if (ghostFor != rewinder.attempts.current()) {
+		ghostFor = rewinder.attempts.current();
+		ghost.select(rewinder.attempts, ghostMode);
+	}
+	ServerWrapper sw = gameWrapper->GetGameEventAsServer();
+	CameraWrapper cam = gameWrapper->GetCamera();
+	if (sw.IsNull() || cam.IsNull()) {
+		return;
+	}
+	if (!ghost.at(rewinder.attempts, sw.GetSecondsElapsed() - rewinder.attemptStart, ghostState)) {
+		return;
+	}
+	// Projecting points behind the camera mirrors them onto the screen.
+	Vec3 forward = toVec3(RotatorToVector(cam.GetRotation()));
+	if (dot(ghostState.car.actorState.location - toVec3(cam.GetLocation()), forward) < 0) {
+		return;
+	}
+	Vec3 corners[8];
+	carBox(ghostState.car.actorState, corners);
+	Vector2F screen[8];
+	for (int i = 0; i < 8; i++) {
+		screen[i] = canvas.ProjectF(toVector(corners[i]));
+	}
+	canvas.SetColor('\x80', '\xc0', '\xff', '\xc0');
+	for (int i = 0; i < 4; i++) {
+		int next = (i + 1) % 4;
+		canvas.DrawLine(screen[i], screen[next], 2);
+		canvas.DrawLine(screen[i + 4], screen[next + 4], 2);
+		canvas.DrawLine(screen[i], screen[i + 4], 2);
+	}
+}
+
+void CheckpointPlugin::dumpProfile(std::vector<std::string> command) {
+	auto path = gameWrapper->GetDataFolder() / PROFILE_FILE_NAME;
+	std::ofstream out(path);
+	profiler.writeCSV(out);
+	if (!out) {
+		cvarManager->log("cpt_profile_dump: error: could not write " + path.string());
+		return;
+	}
+	cvarManager->log("cpt_profile_dump: wrote " + path.string());
+}
+
+// Sends events recorded since the last call to the console when debugging.
+void CheckpointPlugin::printEvents() {
+	if (debug) {
+		events.forEach(printedEvents, [this](const EventRecord& r) {
+			cvarManager->log(formatEvent(r));
+		});
+	}
+	printedEvents = events.count();
+}
+
+void CheckpointPlugin::dumpEvents(std::vector<std::string> command) {
+	auto path = gameWrapper->GetDataFolder() / EVENTS_FILE_NAME;
+	std::ofstream out(path);
+	uint64_t first = 0;
+	events.forEach(0, [&](const EventRecord& r) {
+		if (first == 0) {
+			first = r.time;
+		}
+		out << fmt::format("{:10.3f} {}\n", (r.time - first) / 1e6, formatEvent(r));
+	});
+	if (!out) {
+		cvarManager->log("cpt_events_dump: error: could not write " + path.string());
+		return;
+	}
+	cvarManager->log("cpt_events_dump: wrote " + path.string());
+}
+
+void CheckpointPlugin::exportHistory(std::vector<std::string> command) {
+	auto path = gameWrapper->GetDataFolder() / HISTORY_CSV_FILE_NAME;
+	std::ofstream out(path);
+	writeHistoryCsv(out, rewinder.history, rewinder.inputs, rewinder.interval);
+	if (!out) {
+		cvarManager->log("cpt_export_history: error: could not write " + path.string());
+		return;
+	}
+	cvarManager->log("cpt_export_history: wrote " + path.string());
+}
+
+void CheckpointPlugin::printStats(std::vector<std::string> command) {
+	if (!stats.attached()) {
+		cvarManager->log("cpt_stats: error: could not open the stats file.");
+		return;
+	}
+	for (size_t i = 0; i < checkpoints.size(); i++) {
+		const CheckpointStats* s = stats.find(checkpoints[i].hash());
+		if (s != nullptr) {
+			char line[160];
+			formatStats(*s, line, sizeof(line));
+			cvarManager->log("checkpoint " + std::to_string(i + 1) + ": " + line);
+		}
+	}
+	cvarManager->log("cpt_stats: " + std::to_string(stats.size()) + " checkpoints with stats, room for " +
+		std::to_string(stats.capacity() * 3 / 4));
+}
+
+void CheckpointPlugin::shotPriority(std::vector<std::string> command) {
+	if (command.size() != 2) {
+		cvarManager->log("cpt_shot_priority: error: requires exactly 1 param.");
+		return;
+	}
+	if (curCheckpoint >= checkpoints.size()) {
+		cvarManager->log("cpt_shot_priority: no checkpoint loaded.");
+		return;
+	}
+	int32_t priority = std::clamp(get_safe_int(command[1]), -SHOT_MAX_PRIORITY, SHOT_MAX_PRIORITY);
+	if (!stats.setPriority(checkpoints[curCheckpoint].hash(), priority)) {
+		cvarManager->log("cpt_shot_priority: error: the stats file is full or could not be opened.");
+		return;
+	}
+	scheduler.update(curCheckpoint, stats);
+	cvarManager->log("cpt_shot_priority: checkpoint " + std::to_string(curCheckpoint + 1) +
+		" has priority " + std::to_string(priority));
+}
+
+// Writes a drill pack of variants of the current checkpoint, using the
+// cpt_variance_* settings and cpt_mirror_loads, to <cpt_filename>.variants;
+// set cpt_filename to it to play them.
+void CheckpointPlugin::generateVariants(std::vector<std::string> command) {
+	if (command.size() != 2) {
+		cvarManager->log("cpt_generate_variants: error: requires exactly 1 param.");
+		return;
+	}
+	if (curCheckpoint >= checkpoints.size()) {
+		cvarManager->log("cpt_generate_variants: no checkpoint loaded.");
+		return;
+	}
+	size_t n = size_t(std::clamp<int>(get_safe_int(command[1]), 1, int(MAX_VARIANTS)));
+	auto start = std::chrono::steady_clock::now();
+	std::vector<GameState> variants;
+	// The same seed and checkpoint give the same pack; drawn apart from the drill stream.
+	uint64_t packSeed = Rng::stream(seed, ~checkpoints[curCheckpoint].hash()).next();
+	::generateVariants(checkpoints[curCheckpoint], variance, mirrorLoads, packSeed, n, variants, std::thread::hardware_concurrency());
+
+	// Serialized first, so the file gets a single write.
+	std::ostringstream buffer;
+	writeCheckpointFile(buffer, variants, std::vector<bool>(variants.size(), false));
+	std::string bytes = buffer.str();
+	auto path = gameWrapper->GetDataFolder() / (cvarManager->getCvar("cpt_filename").getStringValue() + std::string(VARIANTS_FILE_SUFFIX));
+	std::ofstream out(path, std::ios::binary | std::ios::out | std::ios::trunc);
+	out.write(bytes.data(), bytes.size());
 	out.close();
+	if (!out) {
+		cvarManager->log("cpt_generate_variants: error: could not write " + path.string());
+		return;
+	}
+	auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	cvarManager->log(fmt::format("cpt_generate_variants: wrote {} variants of checkpoint {} ({} duplicates dropped) to {} in {:.1f} ms",
+		variants.size(), curCheckpoint + 1, n - variants.size(), path.string(), ms));
 }
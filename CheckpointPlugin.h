@@ -12,50 +12,47 @@
 #include "bakkesmod/plugin/pluginwindow.h"
 #include "utils/parser.h"
 #include "state.h"
+#include "core/eventlog.h"
+#include "core/ghost.h"
+#include "core/history.h"
+#include "core/metadata.h"
+#include "core/mirrors.h"
+#include "core/profiler.h"
+#include "core/random.h"
+#include "core/rewinder.h"
+#include "core/scheduler.h"
+#include "core/similarity.h"
+#include "core/spatial.h"
+#include "core/stats.h"
+#include "core/trace.h"
+#include "core/variance.h"
+#include "core/variants.h"
+#include "pipeline.h"
+#include "events.h"
+#include "session.h"
+#include "recovery.h"
+#include "metaworker.h"
 
 #include "version.h"
 
-constexpr auto plugin_version = stringify(VERSION_MAJOR) "." stringify(VERSION_MINOR) "." stringify(VERSION_PATCH) "." stringify(VERSION_BUILD);
-constexpr float MAX_DODGE_TIME = 1.2f;
-
-template<typename T>
-void writePOD(std::ostream& out, const T& t) {
-	out.write(reinterpret_cast<const char*>(&t), sizeof(T));
-}
-
-template<typename T>
-void readPOD(std::istream& in, T& t) {
-	T temp;
-	in.read(reinterpret_cast<char*>(&temp), sizeof(T));
-	if (in.eof()) {
-		return;
-	}
-	t = temp;
-}
-
-// Rotator uses ints instead of floats.  Floats are better.
-struct Rot {
-	float Pitch, Yaw, Roll;
-};
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
 
-// TODO: make this a full-on "RewindMode" class with functions for operations
-struct RewindState {
-	bool atCheckpoint = false;
-	float virtualTimeOffset = 0; // Delta from end of buffer to "now"
-	bool justDeletedCheckpoint = false;
-	bool justLoadedQuickCheckpoint = false;
-	float holdingFor = 0;
-	bool deleting = false;
-	int buttonsDown = 0x7f;
-};
+constexpr auto plugin_version = stringify(VERSION_MAJOR) "." stringify(VERSION_MINOR) "." stringify(VERSION_PATCH) "." stringify(VERSION_BUILD);
 
-class CheckpointPlugin : public BakkesMod::Plugin::BakkesModPlugin {
+class CheckpointPlugin : public BakkesMod::Plugin::BakkesModPlugin, private World {
 	//Boilerplate
 	virtual void onLoad();
 	void copyShot(std::vector<std::string> command);
 	void mirrorState(std::vector<std::string> command);
 	void deleteAllCheckpoints(std::vector<std::string> command);
 	void randCheckpoint(std::vector<std::string> command);
+	void nearestCheckpoint(std::vector<std::string> command);
+	void similarMoment(std::vector<std::string> command);
+	void prevMarker(std::vector<std::string> command);
+	void nextMarker(std::vector<std::string> command);
+	void seekMarker(const std::vector<std::string>& command, bool forward);
 	void pasteShot(std::vector<std::string> command);
 	void freezeBallUnfreezeCar(std::vector<std::string> command);
 	virtual void onUnload();
@@ -63,27 +60,68 @@ class CheckpointPlugin : public BakkesMod::Plugin::BakkesModPlugin {
 	void lockCheckpoint(std::vector<std::string> command);
 	void prevCheckpoint(std::vector<std::string> command);
 	void nextCheckpoint(std::vector<std::string> command);
+	void rewindSession(std::vector<std::string> command);
+	void restoreHistory(std::vector<std::string> command);
 
 private:
-	RewindState rewindState;
-	std::vector<GameState> history;
-	GameState latest;
+	Rewinder rewinder; // history and rewind mode
+	GameState varied; // rewinder.latest with variance applied; reused every tick
 	std::vector<GameState> checkpoints;
 	std::vector<bool> locks;
 	size_t curCheckpoint = 0;
-	bool rewindMode = false;
-	bool freezeBall = false;
-	float dodgeExpiration = 0;
-	bool hasQuickCheckpoint = false;
-	GameState quickCheckpoint;
-	float lastRecordTime = 0;
-	float lastRewindTime = 0;
-	std::vector<GameState> gameHistory;
-	int carNum = 0;
-	bool playingFromCheckpoint = false;
+	std::vector<CheckpointMeta> checkpointMeta; // for each checkpoint; see updateCheckpointMeta()
+	std::unordered_set<uint64_t> metaSent; // hashes of the states sent to metaWorker since the last reload
+	MirrorCache mirrors; // for cpt_mirror_loads
+	MetaWorker metaWorker; // fills checkpointMeta and mirrors off the game thread
+	CheckpointIndex checkpointIndex; // for cpt_nearest_checkpoint
+	// cpt_similar_moment's matches, cycled through while the offset stays where it put it.
+	HistorySearch historySearch;
+	std::vector<HistoryMatch> similarMoments;
+	size_t nextSimilarMoment = 0;
+	float similarMomentOffset = 0;
+	// A previous attempt drawn while playing a checkpoint; see cpt_ghost.
+	Ghost ghost;
+	GameState ghostState;
+	uint64_t ghostFor = 0; // the attempt ghost was selected for; 0 if none
+	GhostMode ghostMode = GHOST_OFF;
+	RecordPipeline pipeline;
+	SessionRecorder sessionRecorder;
+	RecoveryWriter recovery;
+	float lastRecoveryUpdate = 0;
+	VarianceSettings variance; // cached since it is read on every tick while frozen
+	// Randomness, from cpt_seed.  Each drill (a checkpoint, by
+	// GameState::hash()) draws its mirroring and variance from its own stream,
+	// so with the same seed its Nth load comes out the same whatever else was
+	// played in between.
+	uint64_t seed = 0;
+	Rng loadRng; // picks checkpoints for cpt_randomize_loads and cpt_weighted_loads
+	Rng varianceRng; // for the next resume; copied on each tick so they all agree
+	std::unordered_map<uint64_t, Rng> drillRngs;
+	// Outcomes of attempts at each checkpoint, in <cpt_filename>.stats.
+	MappedFile statsFile;
+	StatsTable stats;
+	bool statsFullLogged = false; // since the stats file was opened
+	ShotScheduler scheduler; // for cpt_weighted_loads
+
+	CVarWrapper enableGoalCV = CVarWrapper(0);
+
+	// Heap allocations made by OnPreAsync, to check it stays allocation-free.
+	uint64_t tickAllocations = 0;
+	uint64_t steadyTicks = 0; // ticks since rewind mode last changed
+	uint64_t steadyAllocatingTicks = 0; // ticks after warm-up that allocated
+	bool lastTickRewinding = false;
+
+	Profiler profiler; // enabled by cpt_profile
+
+	EventLog events;
+	uint64_t printedEvents = 0; // events already sent to the console
+
+	// Ticks written to the trace file while cpt_record_trace is set.
+	std::ofstream traceFile;
+	uint8_t traceCommands = 0; // TRACE_* flags for the next tick
+	bool traceTouched = false;
 
 	// Settings:
-	bool deleteFutureHistory = false;
 	bool ignorePNNotFrozen = false;
 	bool ignorePrev = false;
 	bool ignoreNext = false;
@@ -91,37 +129,74 @@ private:
 	bool disableTraining = false;
 	bool disableWorkshop = false;
 	bool debug = false;
-	bool resetOnGoal = false;
-	bool resetOnBallGround = false;
 	bool nextInsteadOfReset = false;
 	bool mirrorLoads = false;
 	bool randomizeLoads = false;
+	bool weightedLoads = false;
 	bool showBoost = false;
+	bool recordSession = false;
+	bool crashRecovery = false;
+	bool recordTrace = false;
 
 	void addBind(std::string key, std::string cmd);
 	void removeBind(std::string key, std::string cmd);
 	void OnPreAsync(std::string funcName);
+	void tick();
 	void registerVarianceCVars();
 	void registerBindingCVars();
 	void captureBindKey(std::vector<std::string> params);
 	void removeBindKeys(std::vector<std::string> params);
 	void applyBindKeys(std::vector<std::string> params);
 	void resetDefaultBindKeys(std::vector<std::string> params);
-	GameState applyVariance(GameState& s);
-	bool rewind(ServerWrapper sw);
+	void applyVariance(const GameState& s, GameState& out);
+	void reseed(uint64_t newSeed);
+	Rng& drillRng(uint64_t checkpoint);
+	void traceTick(ServerWrapper sw);
 	void loadCheckpointFile();
 	void saveCheckpointFile();
+	void openStats();
+	void updateCheckpointMeta(bool reload, bool write);
+	void collectCheckpointMeta();
+
+	void dumpProfile(std::vector<std::string> command);
+	void renderProfile(CanvasWrapper canvas);
+	void renderGhost(CanvasWrapper canvas);
+	void printEvents();
+	void dumpEvents(std::vector<std::string> command);
+	void exportHistory(std::vector<std::string> command);
+	void printStats(std::vector<std::string> command);
+	void shotPriority(std::vector<std::string> command);
+	void generateVariants(std::vector<std::string> command);
+
 	void Render(CanvasWrapper canvas);
-	void record(ServerWrapper sw);
 	void loadLatestCheckpoint();
 	void loadCurCheckpoint();
 	void loadRandomCheckpoint();
-	void loadGameState(const GameState&);
-	void log(std::string s);
+	void loadGameState(const GameState&, uint64_t checkpoint = 0);
+	void log(const std::string& s);
+	void log(const char* s);
 	void boolvar(std::string name, std::string desc, bool* var);
 	std::unique_ptr<GameState> getReplayGameState();
 	void setFrozen(bool car, bool ball);
 	void writeSettingsFile();
 	bool enabled();
 	bool enabledLoads();
+	void updateHistorySize();
+	void updateMemoryUsage();
+
+	// World, over the BakkesMod wrappers; see world.cpp.
+	GameState capture() override;
+	GameState capture(float lastJumped) override;
+	Vec3 ballLocation() override;
+	Vec3 ballVelocity() override;
+	float ballRadius() override;
+	bool isInGoal(Vec3 location) override;
+	bool carDoubleJumped() override;
+	int carWheelContacts() override;
+	RewindInput input() override;
+	void takeDodge() override;
+	void applyBall(const ActorState& s) override;
+	void frozenChanged(bool car, bool ball) override;
+	void resetShot() override;
+	void recorded(const GameState& s, float time) override;
 };
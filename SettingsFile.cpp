@@ -76,6 +76,10 @@ void CheckpointPlugin::writeSettingsFile() {
 9|
 1|Randomly mirror when loading checkpoint|cpt_mirror_loads
 1|Load random checkpoint instead of latest|cpt_randomize_loads
+1|Load weighted checkpoint instead of latest -- Favors shots missed often or not played lately|cpt_weighted_loads
+9|Random seed (0 for a new one each session):
+7|
+12||cpt_seed
 8|
 9|
 9|Auto-reset checkpoint - reset when the following occurs:
@@ -96,10 +100,17 @@ void CheckpointPlugin::writeSettingsFile() {
 9|
 1|Show player boost while rewinding|cpt_show_boost
 1|Clean History -- Erases future history points when resuming|cpt_clean_history
+1|Preview Ball Flight -- Steer past the end of history to see where the ball goes|cpt_preview_future
 5|History Length (seconds)|cpt_history_length|10|120
 5|History Refresh Rate (ms)|cpt_snapshot_interval|1|10
+5|History Memory Budget (MB; 0 = unlimited)|cpt_history_budget_mb|0|64
+5|Attempt Memory (MB; 0 = off) -- Keeps every try at a checkpoint|cpt_attempt_memory_mb|0|256
+6|Ghost -- Outlines the car of an earlier attempt while playing a checkpoint|cpt_ghost|Off@0&Best (soonest goal)@1&Most recent@2
+1|Record Session -- Saves the whole freeplay session to disk (see cpt_rewind_session)|cpt_record_session
+1|Crash Recovery -- Periodically saves history to disk (see cpt_restore_history)|cpt_crash_recovery
 9|
 1|Debug -- Show debugging state|cpt_debug
+1|Profile -- Show hot-path latency (see cpt_profile_dump)|cpt_profile
 9|
 9|
 9| Freeplay Checkpoint
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "alloccount.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replacing the global operators only affects allocations made from this DLL.
+static std::atomic<uint64_t> allocations = 0;
+
+uint64_t allocationCount() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+static void* countedAlloc(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size) {
+	if (void* p = countedAlloc(size)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	if (void* p = countedAlloc(size)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// Number of heap allocations made through operator new by this plugin.  Used to
+// check that the per-tick paths do not allocate.
+uint64_t allocationCount();
@@ -0,0 +1,705 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "bench.h"
+
+#include "core/attempts.h"
+#include "core/ballistics.h"
+#include "core/eventlog.h"
+#include "core/ghost.h"
+#include "core/inputs.h"
+#include "core/markers.h"
+#include "core/metadata.h"
+#include "core/mirrors.h"
+#include "core/profiler.h"
+#include "core/random.h"
+#include "core/savefile.h"
+#include "core/scheduler.h"
+#include "core/similarity.h"
+#include "core/spatial.h"
+#include "core/state.h"
+#include "core/stats.h"
+#include "core/variance.h"
+#include "core/variants.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+std::string BenchRunner::json() const {
+	std::ostringstream out;
+	out << "{\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		auto& r = results[i];
+		char line[512];
+		snprintf(line, sizeof(line),
+			"    {\"name\": \"%s\", \"n\": %zu, \"iterations\": %llu, \"ns_per_op\": %.3f, \"ns_per_item\": %.3f}%s\n",
+			r.name.c_str(), r.n, (unsigned long long)r.iterations, r.nsPerOp, r.nsPerItem, i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+	out << "  ]\n}\n";
+	return out.str();
+}
+
+static std::mt19937 gen(1234);
+
+static float uniform(float min, float max) {
+	return std::uniform_real_distribution<float>(min, max)(gen);
+}
+
+static Vec3 randomVec(float range) {
+	return { uniform(-range, range), uniform(-range, range), uniform(-range, range) };
+}
+
+static IRot randomRot() {
+	return { int(uniform(-16384, 16384)), int(uniform(-32768, 32767)), int(uniform(-32768, 32767)) };
+}
+
+static GameState randomState() {
+	GameState s;
+	s.ball.location = randomVec(4000);
+	s.ball.velocity = randomVec(2000);
+	s.ball.rotation = randomRot();
+	s.ball.angVelocity = randomVec(5);
+	s.car.actorState.location = randomVec(4000);
+	s.car.actorState.velocity = randomVec(2000);
+	s.car.actorState.rotation = randomRot();
+	s.car.actorState.angVelocity = randomVec(5);
+	s.car.boostAmount = uniform(0, 1);
+	s.car.hasDodge = true;
+	s.car.lastJumped = -1;
+	return s;
+}
+
+static std::vector<GameState> randomStates(size_t n) {
+	std::vector<GameState> states;
+	states.reserve(n);
+	for (size_t i = 0; i < n; i++) {
+		states.push_back(randomState());
+	}
+	return states;
+}
+
+// Per-state math on the record/rewind/variance paths.
+static void stateBenchmarks(BenchRunner& b) {
+	const size_t N = 1024;
+	auto states = randomStates(N);
+	size_t i = 0;
+
+	b.run("state/interpolate", 1, [&] {
+		GameState s(states[i % N], states[(i + 1) % N], 0.3f);
+		doNotOptimize(s);
+		i++;
+	});
+	b.run("state/mirror", 1, [&] {
+		GameState s = states[i++ % N].mirror();
+		doNotOptimize(s);
+	});
+	VarianceSettings v = { 30, 50, 10, 30, 50, 10, 50 };
+	GameState out;
+	Rng rng(1234);
+	b.run("variance/applyVariance", 1, [&] {
+		applyVariance(states[i++ % N], out, v, rng);
+		doNotOptimize(out);
+	});
+	b.run("variance/deflect", 1, [&] {
+		Vec3 d = deflect(states[i++ % N].ball.velocity, 15, 1.1f, 1000);
+		doNotOptimize(d);
+	});
+	b.run("variance/RotToQuat", 1, [&] {
+		auto& r = states[i++ % N].car.actorState.rotation;
+		Quat4 q = RotToQuat({ float(r.Pitch), float(r.Yaw), float(r.Roll) });
+		doNotOptimize(q);
+	});
+	b.run("variance/VectorToRot", 1, [&] {
+		Rot r = VectorToRot(states[i++ % N].ball.velocity);
+		doNotOptimize(r);
+	});
+}
+
+// Clipboard/share encoding.
+static void codecBenchmarks(BenchRunner& b) {
+	const size_t N = 256;
+	auto states = randomStates(N);
+	std::vector<std::string> encoded;
+	std::vector<std::string> raw;
+	for (auto& s : states) {
+		encoded.push_back(s.toString());
+		raw.push_back(base64dec(encoded.back()));
+	}
+	size_t i = 0;
+
+	b.run("codec/base64enc", 1, [&] {
+		std::string s = base64enc(raw[i++ % N]);
+		doNotOptimize(s);
+	});
+	b.run("codec/base64dec", 1, [&] {
+		std::string s = base64dec(encoded[i++ % N]);
+		doNotOptimize(s);
+	});
+	b.run("codec/toString", 1, [&] {
+		std::string s = states[i++ % N].toString();
+		doNotOptimize(s);
+	});
+	b.run("codec/fromString", 1, [&] {
+		GameState s(encoded[i++ % N]);
+		doNotOptimize(s);
+	});
+}
+
+// Cost of the profiler's timers on the hot paths.
+static void profilerBenchmarks(BenchRunner& b) {
+	Profiler profiler;
+	uint64_t v = 1;
+	b.run("profiler/histogram_add", 1, [&] {
+		profiler.stages[PROFILE_TICK].add(v);
+		v = v * 3 % 1000003;
+	});
+	b.run("profiler/timer_disabled", 1, [&] {
+		ScopedTimer timer(profiler, PROFILE_RECORD);
+	});
+	profiler.enabled = true;
+	b.run("profiler/timer_enabled", 1, [&] {
+		ScopedTimer timer(profiler, PROFILE_RECORD);
+	});
+
+	static EventLog events;
+	size_t i = 0;
+	b.run("events/trace", 1, [&] {
+		events.trace(EVENT_CHECKPOINT_ADDED, i++);
+	});
+}
+
+// Ball flight prediction: one ball to its next event, and landing spots for
+// many balls one at a time and batched.
+static void ballisticsBenchmarks(BenchRunner& b) {
+	auto states = randomStates(1024);
+	for (auto& s : states) {
+		s.ball.location.Z = uniform(200, 1800);
+	}
+	size_t i = 0;
+	b.run("ballistics/predictBall", 1, [&] {
+		auto& ball = states[i++ % states.size()].ball;
+		BallPrediction p = predictBall(ball.location, ball.velocity, BALL_RADIUS, 10, BALL_GROUND | BALL_GOAL);
+		doNotOptimize(p);
+	});
+	for (size_t n : { 1000, 100000 }) {
+		BallBatch balls;
+		for (size_t j = 0; j < n; j++) {
+			auto& ball = states[j % states.size()].ball;
+			balls.add(ball.location, ball.velocity);
+		}
+		std::string suffix = "/" + std::to_string(n);
+		b.run("ballistics/landings_scalar" + suffix, n, [&] {
+			for (size_t j = 0; j < n; j++) {
+				BallPrediction p = predictBall({ balls.x[j], balls.y[j], balls.z[j] }, { balls.vx[j], balls.vy[j], balls.vz[j] }, BALL_RADIUS, 10, BALL_GROUND);
+				doNotOptimize(p);
+			}
+		});
+		BallBatch batch;
+		b.run("ballistics/landings_batch" + suffix, n, [&] {
+			batch = balls;
+			predictLandings(batch, BALL_RADIUS, 10);
+			doNotOptimize(batch.landTime.data());
+		});
+	}
+}
+
+// Checkpoint metadata: computed from scratch on one and on all cores, and
+// looked up from a warm cache.
+static void metaBenchmarks(BenchRunner& b) {
+	unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+	for (size_t n : { 1000, 100000 }) {
+		auto checkpoints = randomStates(n);
+		std::vector<CheckpointMeta> meta(n);
+		std::string suffix = "/" + std::to_string(n);
+		b.run("meta/compute_1thread" + suffix, n, [&] {
+			computeMeta(checkpoints.data(), n, meta.data(), 1);
+			doNotOptimize(meta.data());
+		});
+		b.run("meta/compute_allcores" + suffix, n, [&] {
+			computeMeta(checkpoints.data(), n, meta.data(), cores);
+			doNotOptimize(meta.data());
+		});
+		MetaCache cache;
+		updateMeta(checkpoints, cache, meta, cores);
+		b.run("meta/cached" + suffix, n, [&] {
+			updateMeta(checkpoints, cache, meta, cores);
+			doNotOptimize(meta.data());
+		});
+	}
+	auto states = randomStates(1024);
+	size_t i = 0;
+	b.run("state/hash", 1, [&] {
+		uint64_t h = states[i++ % states.size()].hash();
+		doNotOptimize(h);
+	});
+}
+
+// Nearest checkpoint lookups against a linear scan.  Queries are random
+// states, the worst case, or near a saved checkpoint, as when replaying one.
+static void spatialBenchmarks(BenchRunner& b) {
+	auto queries = randomStates(1024);
+	for (size_t n : { 1000, 100000 }) {
+		auto checkpoints = randomStates(n);
+		std::vector<GameState> nearQueries;
+		for (size_t j = 0; j < 1024; j++) {
+			GameState s = checkpoints[j * 7919 % n];
+			s.ball.location = s.ball.location + randomVec(200);
+			s.car.actorState.location = s.car.actorState.location + randomVec(200);
+			s.ball.velocity = s.ball.velocity + randomVec(300);
+			nearQueries.push_back(s);
+		}
+		CheckpointIndex index;
+		std::string suffix = "/" + std::to_string(n);
+		b.run("spatial/build" + suffix, n, [&] {
+			index.build(checkpoints);
+		});
+		size_t i = 0;
+		b.run("spatial/nearest_random" + suffix, 1, [&] {
+			size_t nearest;
+			index.nearest(queries[i++ % queries.size()], nearest);
+			doNotOptimize(nearest);
+		});
+		b.run("spatial/nearest_near" + suffix, 1, [&] {
+			size_t nearest;
+			index.nearest(nearQueries[i++ % nearQueries.size()], nearest);
+			doNotOptimize(nearest);
+		});
+
+		b.run("spatial/linear" + suffix, 1, [&] {
+			auto& q = queries[i++ % queries.size()];
+			size_t nearest = 0;
+			float best = INFINITY;
+			for (size_t j = 0; j < n; j++) {
+				auto& c = checkpoints[j];
+				float d = dot(c.ball.location - q.ball.location, c.ball.location - q.ball.location) +
+					dot(c.car.actorState.location - q.car.actorState.location, c.car.actorState.location - q.car.actorState.location) +
+					NEAREST_VELOCITY_WEIGHT * NEAREST_VELOCITY_WEIGHT * (
+						dot(c.ball.velocity - q.ball.velocity, c.ball.velocity - q.ball.velocity) +
+						dot(c.car.actorState.velocity - q.car.actorState.velocity, c.car.actorState.velocity - q.car.actorState.velocity));
+				if (d < best) {
+					best = d;
+					nearest = j;
+				}
+			}
+			doNotOptimize(nearest);
+		});
+	}
+}
+
+// Top-5 similar moments in a full history: 120 s at 10 ms and at 1 ms.
+static void similarityBenchmarks(BenchRunner& b) {
+	auto queries = randomStates(64);
+	for (size_t n : { 12000, 120000 }) {
+		HistoryBuffer<GameState> history;
+		history.setCapacity(n);
+		for (size_t j = 0; j < n + n / 3; j++) { // wrapped around, as when recording
+			history.push_back(randomState());
+		}
+		HistorySearch search;
+		std::vector<HistoryMatch> matches;
+		size_t i = 0;
+		// While rewinding history is frozen, so only the first search gathers it.
+		b.run("similarity/search/" + std::to_string(n), n, [&] {
+			search.search(history, queries[i++ % queries.size()], 5, 100, SIZE_MAX, matches);
+			doNotOptimize(matches.data());
+		});
+		b.run("similarity/changed/" + std::to_string(n), n, [&] {
+			history.push_back(queries[i % queries.size()]);
+			search.search(history, queries[i++ % queries.size()], 5, 100, SIZE_MAX, matches);
+			doNotOptimize(matches.data());
+		});
+	}
+}
+
+// Marker detection per recorded snapshot, against recording alone, and
+// seeking between markers.  A bounce or boost change every 50 snapshots.
+static void markerBenchmarks(BenchRunner& b) {
+	const size_t N = 12000;
+	auto states = randomStates(1024);
+	for (size_t j = 0; j < states.size(); j++) {
+		states[j].ball.velocity = { 0, 0, -float(j % 50) * 5 };
+		states[j].car.boosting = (j / 50) % 3 == 0;
+	}
+	HistoryBuffer<GameState> history;
+	history.setCapacity(N);
+	size_t i = 0;
+	b.run("markers/record", 1, [&] {
+		history.push_back(states[i++ % states.size()]);
+		doNotOptimize(history.back());
+	});
+	MarkerIndex markers;
+	b.run("markers/record_detect", 1, [&] {
+		history.push_back(states[i++ % states.size()]);
+		markers.detect(history, 4, false);
+		doNotOptimize(history.back());
+	});
+	size_t index = 0;
+	b.run("markers/next", 1, [&] {
+		index = (index + 997) % N;
+		size_t found = index;
+		doNotOptimize(markers.next(history, found));
+	});
+	b.run("markers/previous_touch", 1, [&] {
+		index = (index + 997) % N;
+		size_t found = index;
+		doNotOptimize(markers.previous(history, found, MARK_TOUCH)); // none; walks every marker
+	});
+}
+
+// Input recording per snapshot: held steady (runs extend) and a stick that
+// wanders every snapshot (a run each).
+static void inputBenchmarks(BenchRunner& b) {
+	const size_t N = 12000;
+	HistoryBuffer<GameState> history;
+	history.setCapacity(N);
+	GameState s = randomState();
+	for (bool steady : { true, false }) {
+		InputHistory inputs;
+		RewindInput in;
+		in.throttle = 1;
+		size_t i = 0;
+		b.run(steady ? "inputs/record_steady" : "inputs/record_changing", 1, [&] {
+			if (!steady) {
+				in.steer = sinf(i * 0.1f);
+			}
+			history.push_back(s);
+			inputs.record(history, in);
+			i++;
+		});
+		doNotOptimize(inputs.runs());
+	}
+}
+
+// Attempt recording per snapshot, over a drill of 5 s attempts cycling
+// through a full pool so new chunks evict old attempts.
+static void attemptBenchmarks(BenchRunner& b) {
+	GameState s = randomState();
+	RewindInput in;
+	in.throttle = 1;
+	AttemptRecorder attempts;
+	attempts.setCapacity(8 * 1024 * 1024);
+	const uint32_t ATTEMPT_SAMPLES = 500; // 5 s at the default refresh rate
+	uint64_t n = 0;
+	b.run("attempts/attempt", ATTEMPT_SAMPLES, [&] {
+		attempts.start(n++ % 16, 0.01f);
+		for (uint32_t i = 0; i < ATTEMPT_SAMPLES; i++) {
+			attempts.record(s, in);
+		}
+		doNotOptimize(attempts.finish());
+	});
+	doNotOptimize(attempts.countFor(0));
+}
+
+// A ghost's state for one frame, 20 s into a 30 s attempt, next to the
+// same interpolation between two history snapshots.
+static void ghostBenchmarks(BenchRunner& b) {
+	auto states = randomStates(1024);
+	RewindInput in;
+	AttemptRecorder attempts;
+	attempts.setCapacity(8 * 1024 * 1024);
+	const uint32_t SAMPLES = 3000;
+	attempts.start(1, 0.01f);
+	for (uint32_t i = 0; i < SAMPLES; i++) {
+		attempts.record(states[i % states.size()], in);
+	}
+	attempts.finish();
+	attempts.start(1, 0.01f);
+	Ghost ghost;
+	b.run("ghost/select", 1, [&] {
+		doNotOptimize(ghost.select(attempts, GHOST_BEST));
+	});
+	GameState out;
+	float t = 20;
+	b.run("ghost/at", 1, [&] {
+		t = t < 20.1f ? t + 0.0042f : 20; // 240 fps
+		doNotOptimize(ghost.at(attempts, t, out));
+		doNotOptimize(out);
+	});
+	b.run("ghost/history_interpolate", 1, [&] {
+		t = t < 20.1f ? t + 0.0042f : 20;
+		float offset = t / 0.01f;
+		size_t i = size_t(offset);
+		out = GameState(states[i % states.size()], states[(i + 1) % states.size()], 1 - (offset - floorf(offset)));
+		doNotOptimize(out);
+	});
+	Vec3 corners[8];
+	b.run("ghost/car_box", 1, [&] {
+		carBox(out.car.actorState, corners);
+		doNotOptimize(corners);
+	});
+}
+
+// Counting an attempt and looking up a checkpoint in a stats table that is
+// half full, as the plugin's is at 2048 checkpoints.
+static void statsBenchmarks(BenchRunner& b) {
+	const uint32_t SLOTS = 4096;
+	std::vector<char> memory(StatsTable::bytesFor(SLOTS));
+	StatsTable stats;
+	stats.attach(memory.data(), memory.size());
+	std::vector<uint64_t> keys;
+	for (uint32_t i = 0; i < SLOTS / 2; i++) {
+		keys.push_back(randomState().hash());
+		stats.record(keys.back(), AttemptOutcome());
+	}
+	AttemptOutcome outcome;
+	outcome.touchTime = 1.2f;
+	outcome.goalTime = 2.5f;
+	outcome.goalSpeed = 2000;
+	size_t i = 0;
+	b.run("stats/record", 1, [&] {
+		doNotOptimize(stats.record(keys[i++ % keys.size()], outcome));
+	});
+	b.run("stats/find", 1, [&] {
+		doNotOptimize(stats.find(keys[i++ % keys.size()]));
+	});
+	b.run("stats/find_missing", 1, [&] {
+		doNotOptimize(stats.find(i++));
+	});
+}
+
+// Weighted shot picks and weight updates over libraries up to 100k shots.
+static void schedulerBenchmarks(BenchRunner& b) {
+	std::vector<char> memory(StatsTable::bytesFor(4096));
+	StatsTable stats;
+	stats.attach(memory.data(), memory.size());
+	std::uniform_real_distribution<double> u(0, 1);
+	for (size_t n : { 100, 100000 }) {
+		auto checkpoints = randomStates(n);
+		for (size_t i = 0; i < std::min<size_t>(n, 2000); i++) {
+			stats.record(checkpoints[i].hash(), AttemptOutcome());
+		}
+		std::string suffix = "/" + std::to_string(n);
+		ShotScheduler scheduler;
+		b.run("scheduler/rebuild" + suffix, n, [&] {
+			scheduler.invalidate();
+			doNotOptimize(scheduler.next(checkpoints, stats, 0.5));
+		});
+		b.run("scheduler/next" + suffix, 1, [&] {
+			doNotOptimize(scheduler.next(checkpoints, stats, u(gen)));
+		});
+		WeightedSampler sampler;
+		sampler.assign(std::vector<double>(n, 1.0));
+		size_t i = 0;
+		b.run("scheduler/sampler_set" + suffix, 1, [&] {
+			i = (i + 7919) % n;
+			sampler.set(i, u(gen));
+		});
+	}
+}
+
+// The plugin's generator against the standard library's, one at a time and
+// in batches.
+static void randomBenchmarks(BenchRunner& b) {
+	const size_t N = 64;
+	float out[N];
+	Rng rng(1234);
+	std::mt19937 mt(1234);
+	std::uniform_real_distribution<float> u(-1000, 1000);
+	std::normal_distribution<float> normal;
+	b.run("random/mt19937_uniform", 1, [&] {
+		doNotOptimize(u(mt));
+	});
+	b.run("random/uniform", 1, [&] {
+		doNotOptimize(rng.uniform(-1000, 1000));
+	});
+	b.run("random/fill_uniform", N, [&] {
+		rng.fillUniform(out, N, -1000, 1000);
+		doNotOptimize(out);
+	});
+	b.run("random/mt19937_normal", N, [&] {
+		for (size_t i = 0; i < N; i++) {
+			out[i] = normal(mt);
+		}
+		doNotOptimize(out);
+	});
+	b.run("random/fill_normal", N, [&] {
+		rng.fillNormal(out, N);
+		doNotOptimize(out);
+	});
+}
+
+// cpt_generate_variants, from generating to serializing the pack.
+static void variantBenchmarks(BenchRunner& b) {
+	GameState s = randomState();
+	VarianceSettings v = { 30, 50, 10, 30, 50, 10, 50 };
+	unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<GameState> variants;
+	uint64_t seed = 0;
+	for (size_t n : { 500, 10000 }) {
+		std::string suffix = "/" + std::to_string(n);
+		b.run("variants/generate_1thread" + suffix, n, [&] {
+			doNotOptimize(generateVariants(s, v, true, seed++, n, variants, 1));
+		});
+		b.run("variants/generate" + suffix, n, [&] {
+			doNotOptimize(generateVariants(s, v, true, seed++, n, variants, cores));
+		});
+		b.run("variants/serialize" + suffix, n, [&] {
+			std::ostringstream out;
+			writeCheckpointFile(out, variants, std::vector<bool>(variants.size(), false));
+			doNotOptimize(out.str().size());
+		});
+	}
+}
+
+// The batch rotation kernels against their scalar forms.
+static void rotationBenchmarks(BenchRunner& b) {
+	const size_t N = 1024;
+	auto states = randomStates(N);
+	Vec3Batch velocity;
+	RotBatch rots;
+	velocity.resize(N);
+	rots.resize(N);
+	std::vector<float> dir(N), speed(N), roll(N);
+	for (size_t i = 0; i < N; i++) {
+		auto& r = states[i].car.actorState.rotation;
+		velocity.set(i, states[i].ball.velocity);
+		rots.pitch[i] = float(r.Pitch);
+		rots.yaw[i] = float(r.Yaw);
+		rots.roll[i] = float(r.Roll);
+		dir[i] = uniform(0, 30);
+		speed[i] = uniform(0.5f, 1.5f);
+		roll[i] = uniform(-32768, 32764);
+	}
+	Vec3Batch deflected;
+	QuatBatch quats;
+	RotBatch found;
+	b.run("rotation/RotToQuat_scalar", N, [&] {
+		for (size_t i = 0; i < N; i++) {
+			doNotOptimize(RotToQuat({ rots.pitch[i], rots.yaw[i], rots.roll[i] }));
+		}
+	});
+	b.run("rotation/RotToQuat_batch", N, [&] {
+		RotToQuatBatch(rots, quats);
+		doNotOptimize(quats.w.data());
+	});
+	b.run("rotation/VectorToRot_scalar", N, [&] {
+		for (size_t i = 0; i < N; i++) {
+			doNotOptimize(VectorToRot(velocity.get(i)));
+		}
+	});
+	b.run("rotation/VectorToRot_batch", N, [&] {
+		VectorToRotBatch(velocity, found);
+		doNotOptimize(found.yaw.data());
+	});
+	b.run("rotation/deflect_scalar", N, [&] {
+		for (size_t i = 0; i < N; i++) {
+			doNotOptimize(deflect(velocity.get(i), dir[i], speed[i], roll[i]));
+		}
+	});
+	b.run("rotation/deflect_batch", N, [&] {
+		deflectBatch(velocity, dir.data(), speed.data(), roll.data(), deflected);
+		doNotOptimize(deflected.x.data());
+	});
+}
+
+// Getting a checkpoint's mirror image for a mirrored load: mirroring it each
+// time against the cache, and filling the cache for a whole library.
+static void mirrorBenchmarks(BenchRunner& b) {
+	const size_t N = 1000;
+	auto checkpoints = randomStates(N);
+	size_t i = 0;
+	GameState loaded;
+	b.run("mirrors/mirror", 1, [&] {
+		loaded = checkpoints[i++ % N].mirror();
+		doNotOptimize(loaded);
+	});
+	MirrorCache mirrors;
+	mirrors.fill(checkpoints);
+	b.run("mirrors/cached", 1, [&] {
+		loaded = mirrors.mirrored(checkpoints, i++ % N);
+		doNotOptimize(loaded);
+	});
+	b.run("mirrors/fill", N, [&] {
+		mirrors.invalidate();
+		mirrors.fill(checkpoints);
+	});
+}
+
+// Save file load/save, including the file system.
+static void saveFileBenchmarks(BenchRunner& b) {
+	auto path = std::filesystem::temp_directory_path() / "checkpointbench.data";
+	for (size_t n : { 10, 1000, 100000 }) {
+		auto checkpoints = randomStates(n);
+		std::vector<bool> locks(n);
+		std::string suffix = "/" + std::to_string(n);
+		b.run("savefile/save" + suffix, n, [&] {
+			std::ofstream out(path, std::ios::binary | std::ios::out | std::ios::trunc);
+			writeCheckpointFile(out, checkpoints, locks);
+		});
+		std::vector<GameState> loaded;
+		std::vector<bool> loadedLocks;
+		b.run("savefile/load" + suffix, n, [&] {
+			std::ifstream in(path, std::ios::binary);
+			uint32_t version;
+			readCheckpointFile(in, loaded, loadedLocks, version);
+			doNotOptimize(loaded.data());
+		});
+	}
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+}
+
+static void usage() {
+	fprintf(stderr, "usage: checkpointbench [--out <file.json>] [--filter <substring>] [--min-time <seconds>]\n");
+}
+
+int main(int argc, char** argv) {
+	BenchRunner b;
+	const char* outPath = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && strcmp(argv[i], "--out") == 0) {
+			outPath = argv[++i];
+		} else if (i + 1 < argc && strcmp(argv[i], "--filter") == 0) {
+			b.filter = argv[++i];
+		} else if (i + 1 < argc && strcmp(argv[i], "--min-time") == 0) {
+			b.minTime = atof(argv[++i]);
+		} else {
+			usage();
+			return 2;
+		}
+	}
+
+	stateBenchmarks(b);
+	codecBenchmarks(b);
+	profilerBenchmarks(b);
+	ballisticsBenchmarks(b);
+	metaBenchmarks(b);
+	spatialBenchmarks(b);
+	similarityBenchmarks(b);
+	markerBenchmarks(b);
+	inputBenchmarks(b);
+	attemptBenchmarks(b);
+	ghostBenchmarks(b);
+	statsBenchmarks(b);
+	schedulerBenchmarks(b);
+	randomBenchmarks(b);
+	variantBenchmarks(b);
+	rotationBenchmarks(b);
+	mirrorBenchmarks(b);
+
+	saveFileBenchmarks(b);
+
+	for (auto& r : b.results) {
+		fprintf(stderr, "%-32s n=%-7zu %12.1f ns/op %10.2f ns/item\n", r.name.c_str(), r.n, r.nsPerOp, r.nsPerItem);
+	}
+	std::string json = b.json();
+	if (outPath == nullptr) {
+		fputs(json.c_str(), stdout);
+		return 0;
+	}
+	std::ofstream out(outPath);
+	out << json;
+	return out ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal benchmark harness.  Each benchmark is timed in batches until
+// minTime has passed; the fastest batch is reported.
+
+struct BenchResult {
+	std::string name;
+	size_t n; // problem size (records, states, ...); 1 if not applicable
+	uint64_t iterations;
+	double nsPerOp; // per call of the benchmarked function
+	double nsPerItem; // nsPerOp / n
+};
+
+class BenchRunner {
+public:
+	double minTime = 0.2; // seconds per benchmark
+	std::string filter;
+
+	template<typename F>
+	void run(const std::string& name, size_t n, F f) {
+		if (!filter.empty() && name.find(filter) == std::string::npos) {
+			return;
+		}
+		using clock = std::chrono::steady_clock;
+		uint64_t batch = 1;
+		uint64_t total = 0;
+		double best = 1e300;
+		auto start = clock::now();
+		while (std::chrono::duration<double>(clock::now() - start).count() < minTime || total == 0) {
+			auto t0 = clock::now();
+			for (uint64_t i = 0; i < batch; i++) {
+				f();
+			}
+			double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+			total += batch;
+			best = std::min(best, ns / batch);
+			if (ns < 1e6) {
+				batch *= 2; // Keep batches long enough to time accurately.
+			}
+		}
+		results.push_back({ name, n, total, best, best / n });
+	}
+
+	// Writes results as JSON.
+	std::string json() const;
+
+	std::vector<BenchResult> results;
+};
+
+// Prevents the compiler from optimizing away a computed value.
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
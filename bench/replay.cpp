@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Replays a tick trace (written by cpt_record_trace, or synthesized) through
+// the Rewinder, the same record/rewind logic the plugin runs in its
+// PlayerMove hook, and reports throughput and per-tick latency.
+//
+// The world is open-loop: every tick sees the traced ball and car regardless
+// of what the Rewinder applied.  Recorded snapshots go to a counter instead of
+// the session/recovery pipeline.
+
+#include "bench.h"
+
+#include "core/rewinder.h"
+#include "core/trace.h"
+#include "core/variance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+constexpr float TICK_RATE = 120; // PlayerMove calls per second
+constexpr float SYNTHETIC_SESSION_TIME = 600; // s
+
+// A freeplay session with a scripted rewind every 20 s: play for 12 s,
+// freeze, rewind for 3 s, scrub forward, sometimes save a checkpoint, then
+// resume.  Every fourth cycle loads the latest checkpoint mid-play and some
+// shots score to exercise cpt_reset_on_goal.
+static std::vector<TraceTick> syntheticTrace(float seconds) {
+	std::vector<TraceTick> ticks;
+	size_t n = size_t(seconds * TICK_RATE);
+	ticks.reserve(n);
+	for (size_t i = 0; i < n; i++) {
+		float t = i / TICK_RATE;
+		int cycle = int(t / 20);
+		float p = t - cycle * 20.0f;
+		float prev = i == 0 ? -1 : (i - 1) / TICK_RATE - cycle * 20.0f;
+		auto crossed = [&](float at) { return prev < at && p >= at; };
+
+		TraceTick tick = {};
+		tick.time = t;
+		GameState& s = tick.state;
+		s.ball.location = { 3000 * sinf(t * 0.3f), 4000 * cosf(t * 0.2f), 93 + 1200 * fabsf(sinf(t * 1.5f)) };
+		s.ball.velocity = { 900 * cosf(t * 0.3f), -800 * sinf(t * 0.2f), 1800 * cosf(t * 1.5f) };
+		s.ball.rotation = { int(t * 4000) % 65536 - 32768, int(t * 3000) % 65536 - 32768, 0 };
+		s.ball.angVelocity = { 1, 2, 0.5f };
+		s.car.actorState.location = { 2000 * cosf(t * 0.5f), 2000 * sinf(t * 0.5f), 17 };
+		s.car.actorState.velocity = { -1000 * sinf(t * 0.5f), 1000 * cosf(t * 0.5f), 0 };
+		s.car.actorState.rotation = { 0, int(t * 0.5f * 10430.4f) % 65536 - 32768, 0 };
+		s.car.actorState.angVelocity = { 0, 0, 0.5f };
+		s.car.boostAmount = 0.33f;
+		s.car.hasDodge = true;
+		s.car.lastJumped = -1;
+		s.time = -1;
+		tick.ballRadius = 92.75f;
+		tick.wheelContacts = 4;
+		if (cycle % 3 == 1 && p >= 8.4f && p < 9.2f) {
+			// A shot, touched at 8.4 s, that crosses the goal line at 9 s.
+			float f = p - 8.4f;
+			s.ball.location = { 0, 5215 - 2500 * (9 - p), 300 - 325 * f * f };
+			s.ball.velocity = { 0, 2500, -650 * f };
+			tick.touched = crossed(8.4f);
+			tick.inGoal = p >= 9;
+		}
+
+		if (p < 12 || p >= 17) {
+			tick.input.throttle = 1;
+		} else if (p < 13 && cycle % 2 == 1) {
+			tick.input.steer = 1; // Previews the predicted future.
+		} else if (p < 15) {
+			tick.input.steer = -1;
+		} else if (p < 16) {
+			tick.input.steer = 0.5f;
+		}
+		if (crossed(12)) {
+			tick.commands |= TRACE_FREEZE;
+		}
+		if (cycle % 3 == 0 && crossed(16)) {
+			tick.commands |= TRACE_DO_CHECKPOINT; // Saves a checkpoint while frozen.
+		}
+		if (cycle % 4 == 3 && crossed(6)) {
+			tick.commands |= TRACE_DO_CHECKPOINT; // Loads the latest checkpoint.
+		}
+		ticks.push_back(tick);
+	}
+	return ticks;
+}
+
+static Rng rng(1234);
+
+// Plays back one trace tick at a time.  Commands get the minimal handling of
+// the plugin's cpt_freeze and cpt_do_checkpoint.
+class ReplayWorld : public World {
+public:
+	explicit ReplayWorld(Rewinder& r) : r(r) {}
+
+	GameState capture() override { return tick->state; }
+	GameState capture(float lastJumped) override {
+		GameState s = tick->state;
+		s.car.lastJumped = lastJumped;
+		s.car.hasDodge = !tick->doubleJumped && lastJumped < MAX_DODGE_TIME;
+		return s;
+	}
+	Vec3 ballLocation() override { return tick->state.ball.location; }
+	Vec3 ballVelocity() override { return tick->state.ball.velocity; }
+	float ballRadius() override { return tick->ballRadius; }
+	bool isInGoal(Vec3) override { return tick->inGoal; }
+	bool carDoubleJumped() override { return tick->doubleJumped; }
+	int carWheelContacts() override { return tick->wheelContacts; }
+	RewindInput input() override { return tick->input; }
+	void takeDodge() override {}
+	void applyBall(const ActorState& s) override { doNotOptimize(s); }
+	void frozenChanged(bool, bool) override {}
+	void resetShot() override { loadLatest(); resets++; }
+	void recorded(const GameState& s, float) override { doNotOptimize(s); snapshots++; }
+
+	void load(const GameState& s) {
+		r.load(s);
+		r.rewindMode = true;
+		r.freezeBall = true;
+		loads++;
+	}
+
+	void loadLatest() {
+		if (r.hasQuickCheckpoint) {
+			load(r.quickCheckpoint);
+			r.hasQuickCheckpoint = true;
+			r.rewindState.justLoadedQuickCheckpoint = true;
+		} else if (!checkpoints.empty()) {
+			load(checkpoints.back());
+			r.rewindState.atCheckpoint = true;
+		}
+	}
+
+	void runCommands() {
+		if (tick->touched) {
+			r.ballTouched();
+		}
+
+		if ((tick->commands & TRACE_FREEZE) && r.history.size() > 0 && !r.rewindMode) {
+			load(r.history.back());
+		}
+		if (tick->commands & TRACE_DO_CHECKPOINT) {
+			if (!r.rewindMode) {
+				loadLatest();
+			} else if (!r.rewindState.atCheckpoint) {
+				r.hasQuickCheckpoint = false;
+				checkpoints.push_back(r.latest);
+				load(r.latest);
+				r.rewindState.atCheckpoint = true;
+			}
+		}
+	}
+
+	const TraceTick* tick = nullptr;
+	std::vector<GameState> checkpoints;
+	uint64_t snapshots = 0;
+	uint64_t resets = 0;
+	uint64_t loads = 0;
+
+private:
+	Rewinder& r;
+};
+
+struct Latency {
+	uint64_t ticks = 0;
+	double p50 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+static Latency latency(std::vector<uint32_t>& ns) {
+	Latency l;
+	l.ticks = ns.size();
+	if (ns.empty()) {
+		return l;
+	}
+	std::sort(ns.begin(), ns.end());
+	l.p50 = ns[ns.size() / 2];
+	l.p99 = ns[std::min(ns.size() - 1, ns.size() * 99 / 100)];
+	l.max = ns.back();
+	return l;
+}
+
+struct ReplayResult {
+	float interval;
+	size_t history;
+	double seconds; // wall time for the whole trace
+	Latency record;
+	Latency rewind;
+	uint64_t snapshots;
+	uint64_t resets;
+	uint64_t loads;
+};
+
+static ReplayResult replay(const std::vector<TraceTick>& ticks, float interval, int historyTime) {
+	using clock = std::chrono::steady_clock;
+	Rewinder r;
+	r.interval = interval;
+	r.resetOnGoal = true;
+	r.previewFuture = true;
+
+	r.setCapacity(size_t(historyTime / interval));
+	r.attempts.setCapacity(8 * 1024 * 1024); // cpt_attempt_memory_mb's default
+	ReplayWorld world(r);
+	VarianceSettings variance;
+	GameState varied;
+	std::vector<uint32_t> recordNs;
+	std::vector<uint32_t> rewindNs;
+	recordNs.reserve(ticks.size());
+	rewindNs.reserve(ticks.size());
+
+	auto start = clock::now();
+	for (auto& t : ticks) {
+		world.tick = &t;
+		auto t0 = clock::now();
+		world.runCommands();
+		bool rewinding = r.rewindMode;
+		if (rewinding) {
+			if (r.rewind(world, t.time, t.input)) {
+				applyVariance(r.latest, varied, variance, rng);
+				doNotOptimize(varied);
+			}
+		} else {
+			r.record(world, t.time);
+		}
+		auto ns = uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count());
+		(rewinding ? rewindNs : recordNs).push_back(ns);
+	}
+	double seconds = std::chrono::duration<double>(clock::now() - start).count();
+	return { interval, r.history.capacity(), seconds, latency(recordNs), latency(rewindNs), world.snapshots, world.resets, world.loads };
+}
+
+static std::string latencyJson(const Latency& l) {
+	char s[160];
+	snprintf(s, sizeof(s), "{\"ticks\": %llu, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %.0f}",
+		(unsigned long long)l.ticks, l.p50, l.p99, l.max);
+	return s;
+}
+
+static void usage() {
+	fprintf(stderr, "usage: checkpointreplay [--trace <file>] [--write-trace <file>] [--interval <s>]... [--history <s>] [--repeat <n>] [--out <file.json>]\n");
+}
+
+int main(int argc, char** argv) {
+	const char* tracePath = nullptr;
+	const char* writePath = nullptr;
+	const char* outPath = nullptr;
+	std::vector<float> intervals;
+	int historyTime = 30;
+	int repeat = 3;
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && strcmp(argv[i], "--trace") == 0) {
+			tracePath = argv[++i];
+		} else if (i + 1 < argc && strcmp(argv[i], "--write-trace") == 0) {
+			writePath = argv[++i];
+		} else if (i + 1 < argc && strcmp(argv[i], "--interval") == 0) {
+			intervals.push_back(float(atof(argv[++i])));
+		} else if (i + 1 < argc && strcmp(argv[i], "--history") == 0) {
+			historyTime = atoi(argv[++i]);
+		} else if (i + 1 < argc && strcmp(argv[i], "--repeat") == 0) {
+			repeat = std::max(1, atoi(argv[++i]));
+		} else if (i + 1 < argc && strcmp(argv[i], "--out") == 0) {
+			outPath = argv[++i];
+		} else {
+			usage();
+			return 2;
+		}
+	}
+	if (intervals.empty()) {
+		intervals = { 0.001f, 0.005f, 0.010f, 0.020f, 0.050f, 0.100f };
+	}
+
+	std::vector<TraceTick> ticks;
+	if (tracePath != nullptr) {
+		std::ifstream in(tracePath, std::ios::binary);
+		if (!readTrace(in, ticks)) {
+			fprintf(stderr, "%s: not a trace file of version %u\n", tracePath, TRACE_FILE_VERSION);
+			return 1;
+		}
+	} else {
+		ticks = syntheticTrace(SYNTHETIC_SESSION_TIME);
+	}
+	if (ticks.empty()) {
+		fprintf(stderr, "empty trace\n");
+		return 1;
+	}
+	if (writePath != nullptr) {
+		std::ofstream out(writePath, std::ios::binary | std::ios::out | std::ios::trunc);
+		writeTraceHeader(out);
+		for (auto& t : ticks) {
+			writeTraceTick(out, t);
+		}
+	}
+
+	std::ostringstream json;
+	json << "{\n  \"trace\": \"" << (tracePath ? tracePath : "synthetic") << "\",\n";
+	json << "  \"ticks\": " << ticks.size() << ",\n";
+	json << "  \"session_seconds\": " << ticks.back().time - ticks.front().time << ",\n";
+	json << "  \"runs\": [\n";
+	for (size_t i = 0; i < intervals.size(); i++) {
+		ReplayResult best = replay(ticks, intervals[i], historyTime);
+		for (int j = 1; j < repeat; j++) {
+			ReplayResult r = replay(ticks, intervals[i], historyTime);
+			if (r.seconds < best.seconds) {
+				best = r;
+			}
+		}
+		double tps = ticks.size() / best.seconds;
+		fprintf(stderr, "interval %.3f s, history %zu: %.2f M ticks/s; record p50 %.0f p99 %.0f max %.0f ns; rewind p50 %.0f p99 %.0f max %.0f ns\n",
+			best.interval, best.history, tps / 1e6,
+			best.record.p50, best.record.p99, best.record.max,
+			best.rewind.p50, best.rewind.p99, best.rewind.max);
+		char head[256];
+		snprintf(head, sizeof(head),
+			"    {\"interval\": %.3f, \"history\": %zu, \"seconds\": %.6f, \"ticks_per_second\": %.0f, \"snapshots\": %llu, \"resets\": %llu, \"loads\": %llu,\n",
+			best.interval, best.history, best.seconds, tps,
+			(unsigned long long)best.snapshots, (unsigned long long)best.resets, (unsigned long long)best.loads);
+		json << head;
+		json << "     \"record\": " << latencyJson(best.record) << ",\n";
+		json << "     \"rewind\": " << latencyJson(best.rewind) << "}" << (i + 1 < intervals.size() ? "," : "") << "\n";
+	}
+	json << "  ]\n}\n";
+
+	if (outPath == nullptr) {
+		fputs(json.str().c_str(), stdout);
+		return 0;
+	}
+	std::ofstream out(outPath);
+	out << json.str();
+	return out ? 0 : 1;
+}
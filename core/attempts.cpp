@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "attempts.h"
+#include "ballistics.h"
+
+#include <algorithm>
+
+void AttemptRecorder::setCapacity(size_t bytes) {
+	size_t chunkBytes = CHUNK_SAMPLES * sizeof(AttemptSample) + sizeof(uint32_t) + sizeof(Attempt);
+	uint32_t n = uint32_t(std::min<size_t>(bytes / chunkBytes, NO_CHUNK - 1));
+	recording_ = false;
+	open = false;
+	if (n != chunks) {
+		pool.reset(n > 0 ? new AttemptSample[size_t(n) * CHUNK_SAMPLES] : nullptr);
+		nextChunk.reset(n > 0 ? new uint32_t[n] : nullptr);
+		chunks = n;
+		attempts.setCapacity(n);
+	}
+	clear();
+}
+
+size_t AttemptRecorder::memoryUsage() const {
+	return size_t(chunks) * (CHUNK_SAMPLES * sizeof(AttemptSample) + sizeof(uint32_t)) +
+		attempts.capacity() * sizeof(Attempt);
+}
+
+void AttemptRecorder::clear() {
+	attempts.clear();
+	recording_ = false;
+	open = false;
+	freeList = NO_CHUNK;
+	for (uint32_t i = chunks; i > 0; i--) {
+		nextChunk[i - 1] = freeList;
+		freeList = i - 1;
+	}
+}
+
+void AttemptRecorder::start(uint64_t checkpoint, float interval) {
+	finish();
+	if (chunks == 0) {
+		return;
+	}
+	started++;
+	recording_ = true;
+	this->checkpoint = checkpoint;
+	this->interval = interval;
+}
+
+void AttemptRecorder::record(const GameState& s, const RewindInput& input) {
+	if (!recording_) {
+		return;
+	}
+	if (!open || attempts.back().samples % CHUNK_SAMPLES == 0) {
+		uint32_t chunk = allocChunk();
+		if (chunk == NO_CHUNK) {
+			return; // The pool holds nothing but this attempt.
+		}
+		nextChunk[chunk] = NO_CHUNK;
+		if (open) {
+			nextChunk[attempts.back().lastChunk] = chunk;
+			attempts.back().lastChunk = chunk;
+		} else {
+			attempts.push_back({ checkpoint, started, interval, -1, 0, chunk, chunk });
+			open = true;
+		}
+	}
+	Attempt& a = attempts.back();
+	AttemptSample& out = pool[size_t(a.lastChunk) * CHUNK_SAMPLES + a.samples % CHUNK_SAMPLES];
+	out.state = s;
+	out.input = packInput(input);
+	if (a.goalTime < 0 && ballInGoal(s.ball.location)) {
+		a.goalTime = a.samples * a.interval;
+	}
+	a.samples++;
+}
+
+const Attempt* AttemptRecorder::finish() {
+	bool recorded = open;
+	recording_ = false;
+	open = false;
+	return recorded ? &attempts.back() : nullptr;
+}
+
+size_t AttemptRecorder::countFor(uint64_t checkpoint) const {
+	size_t n = 0;
+	attempts.forEach([&](size_t, const Attempt& a) {
+		n += a.checkpoint == checkpoint;
+	});
+	return n;
+}
+
+const AttemptSample& AttemptRecorder::sample(const Attempt& a, size_t i) const {
+	uint32_t chunk = a.firstChunk;
+	for (size_t skip = i / CHUNK_SAMPLES; skip > 0; skip--) {
+		chunk = nextChunk[chunk];
+	}
+	return pool[size_t(chunk) * CHUNK_SAMPLES + i % CHUNK_SAMPLES];
+}
+
+uint32_t AttemptRecorder::allocChunk() {
+	while (freeList == NO_CHUNK) {
+		if (attempts.size() <= (open ? 1u : 0u)) {
+			return NO_CHUNK;
+		}
+		freeChunks(attempts[0]);
+		attempts.dropOldest(1);
+	}
+	uint32_t chunk = freeList;
+	freeList = nextChunk[chunk];
+	return chunk;
+}
+
+void AttemptRecorder::freeChunks(const Attempt& a) {
+	nextChunk[a.lastChunk] = freeList;
+	freeList = a.firstChunk;
+}
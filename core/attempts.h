@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "history.h"
+#include "inputs.h"
+#include "state.h"
+
+#include <cstdint>
+#include <memory>
+
+struct AttemptSample {
+	GameState state;
+	uint64_t input; // packInput()
+};
+
+struct Attempt {
+	uint64_t checkpoint; // GameState::hash() of the state play resumed from
+	uint64_t number; // counts attempts since the recorder was created
+	float interval; // s between samples
+	float goalTime; // s from the first sample until the ball was in a goal; -1 if it never was
+	uint32_t samples;
+	uint32_t firstChunk;
+	uint32_t lastChunk;
+};
+
+// Every snapshot and input of each attempt at a checkpoint, from resuming
+// until the next load or reset.  Samples live in one pool allocated by
+// setCapacity() and handed to attempts CHUNK_SAMPLES at a time from a free
+// list, so hundreds of attempts of any length come and go without touching
+// the heap.  When the pool is full the oldest attempt is evicted.
+class AttemptRecorder {
+public:
+	static constexpr uint32_t CHUNK_SAMPLES = 256;
+
+	// Sizes the pool to fit in bytes, dropping every attempt.  0 disables
+	// recording.  Allocates; everything else does not.
+	void setCapacity(size_t bytes);
+	size_t memoryUsage() const;
+
+	// Starts an attempt from checkpoint, finishing any current one.
+	void start(uint64_t checkpoint, float interval);
+	// Appends a sample to the current attempt, if there is one.  An attempt
+	// that outgrows the whole pool stops growing.
+	void record(const GameState& s, const RewindInput& input);
+	// Ends the current attempt.  Returns it, or nullptr if nothing was
+	// recorded.
+	const Attempt* finish();
+	bool recording() const { return recording_; }
+	// The number of the current (or last) attempt, and what it started from.
+	uint64_t current() const { return started; }
+	uint64_t currentCheckpoint() const { return checkpoint; }
+	void clear();
+
+	// Kept attempts, oldest first, including the one being recorded.
+	size_t size() const { return attempts.size(); }
+	const Attempt& operator[](size_t i) const { return attempts[i]; }
+	// Whether the attempt numbered number was kept and is still here.
+	// Attempts are evicted in the order they are numbered.
+	bool kept(uint64_t number) const { return !attempts.empty() && attempts[0].number <= number; }
+	// Number of kept attempts from checkpoint.
+	size_t countFor(uint64_t checkpoint) const;
+	// The i'th sample of a; walks one chunk at a time.
+	const AttemptSample& sample(const Attempt& a, size_t i) const;
+	// Calls f(samples, count) for each chunk of a, in order.
+	template<typename F>
+	void forEachChunk(const Attempt& a, F f) const {
+		uint32_t chunk = a.firstChunk;
+		for (uint32_t i = 0; i < a.samples; i += CHUNK_SAMPLES) {
+			f(&pool[size_t(chunk) * CHUNK_SAMPLES], std::min(CHUNK_SAMPLES, a.samples - i));
+			chunk = nextChunk[chunk];
+		}
+	}
+	// Calls f(sample) for each sample of a, in order.
+	template<typename F>
+	void forEachSample(const Attempt& a, F f) const {
+		forEachChunk(a, [&](const AttemptSample* s, uint32_t n) {
+			for (uint32_t i = 0; i < n; i++) {
+				f(s[i]);
+			}
+		});
+	}
+
+private:
+	static constexpr uint32_t NO_CHUNK = UINT32_MAX;
+
+	// Takes a chunk from the free list, evicting the oldest finished attempt
+	// if it is empty.  NO_CHUNK if every chunk is in the current attempt.
+	uint32_t allocChunk();
+	void freeChunks(const Attempt& a);
+
+	std::unique_ptr<AttemptSample[]> pool; // chunks * CHUNK_SAMPLES
+	std::unique_ptr<uint32_t[]> nextChunk; // per chunk: the next in its attempt or the free list
+	uint32_t chunks = 0;
+	uint32_t freeList = NO_CHUNK;
+	HistoryBuffer<Attempt> attempts; // at most one per chunk, so never overwritten
+	uint64_t started = 0; // attempts started
+	// The current attempt; its entry in attempts is added with its first sample.
+	bool recording_ = false;
+	bool open = false; // attempts.back() is the current attempt
+	uint64_t checkpoint = 0;
+	float interval = 0;
+};
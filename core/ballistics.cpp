@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ballistics.h"
+
+#include <cmath>
+
+constexpr float GRAVITY = -650; // uu/s^2
+constexpr float DRAG = 0.0305f; // fraction of velocity lost per second
+constexpr float MAX_SPEED = 6000;
+constexpr float RESTITUTION = 0.6f; // normal speed kept by a bounce
+constexpr float BOUNCE_FRICTION = 0.285f; // tangential speed lost by a floor bounce
+constexpr float SIDE_WALL_X = 4096;
+constexpr float BACK_WALL_Y = 5120;
+constexpr float CEILING_Z = 2044;
+constexpr float GOAL_HALF_WIDTH = 892.755f;
+constexpr float GOAL_HEIGHT = 642.775f;
+constexpr float CORNER_DIAGONAL = 8064; // |x| + |y| along the corner walls
+// Bands checked every snapshot by ballNearGoalOrCurve.  GOAL_BAND is 0.25 s
+// at MAX_SPEED, more than the coarsest snapshot interval.
+constexpr float GOAL_BAND = 1500;
+constexpr float CURVE_BAND = 512;
+
+// One physics step.  Written as selects without early exits so that
+// predictLandings vectorizes over balls (with -fno-trapping-math on GCC and
+// Clang).  Floor bounces can be left out when only the first ground contact
+// matters.
+template<bool floorBounce = true>
+static inline void stepBall(float& x, float& y, float& z, float& vx, float& vy, float& vz, float radius, float dt) {
+	vz += GRAVITY * dt;
+	float drag = 1 - DRAG * dt;
+	vx *= drag;
+	vy *= drag;
+	vz *= drag;
+	// Rarely true, so scalar code branches around the sqrt.
+	float speed2 = vx * vx + vy * vy + vz * vz;
+	float limit = speed2 > MAX_SPEED * MAX_SPEED ? MAX_SPEED / sqrtf(speed2) : 1;
+	vx *= limit;
+	vy *= limit;
+	vz *= limit;
+
+	x += vx * dt;
+	y += vy * dt;
+	z += vz * dt;
+
+	if (floorBounce) {
+		bool floor = z < radius && vz < 0;
+		z = floor ? radius : z;
+		vx = floor ? vx * (1 - BOUNCE_FRICTION) : vx;
+		vy = floor ? vy * (1 - BOUNCE_FRICTION) : vy;
+		vz = floor ? -vz * RESTITUTION : vz;
+	}
+
+	bool ceiling = z > CEILING_Z - radius && vz > 0;
+	z = ceiling ? CEILING_Z - radius : z;
+	vz = ceiling ? -vz * RESTITUTION : vz;
+
+	bool side = fabsf(x) > SIDE_WALL_X - radius && x * vx > 0;
+	x = side ? copysignf(SIDE_WALL_X - radius, x) : x;
+	vx = side ? -vx * RESTITUTION : vx;
+
+	bool mouth = fabsf(x) < GOAL_HALF_WIDTH - radius && z < GOAL_HEIGHT - radius;
+	bool back = !mouth && fabsf(y) > BACK_WALL_Y - radius && y * vy > 0;
+	y = back ? copysignf(BACK_WALL_Y - radius, y) : y;
+	vy = back ? -vy * RESTITUTION : vy;
+}
+
+static inline bool onGround(float z, float radius) {
+	return z < radius + GROUND_CONTACT;
+}
+
+static inline bool inGoal(float y, float radius) {
+	return fabsf(y) > BACK_WALL_Y + radius;
+}
+
+bool ballInGoal(Vec3 location, float radius) {
+	return inGoal(location.Y, radius);
+}
+
+bool ballNearGoalOrCurve(Vec3 location, float radius) {
+	float x = fabsf(location.X), y = fabsf(location.Y);
+	return y > BACK_WALL_Y - radius - GOAL_BAND ||
+		x > SIDE_WALL_X - radius - CURVE_BAND ||
+		x + y > CORNER_DIAGONAL - radius - CURVE_BAND;
+}
+
+BallPrediction predictBall(Vec3 location, Vec3 velocity, float radius, float horizon, int events) {
+	float x = location.X, y = location.Y, z = location.Z;
+	float vx = velocity.X, vy = velocity.Y, vz = velocity.Z;
+	BallEvent event = BALL_NONE;
+	float t = 0;
+	for (;;) {
+		if ((events & BALL_GROUND) && onGround(z, radius)) {
+			event = BALL_GROUND;
+			break;
+		}
+		if ((events & BALL_GOAL) && inGoal(y, radius)) {
+			event = BALL_GOAL;
+			break;
+		}
+		if (t >= horizon) {
+			break;
+		}
+		stepBall(x, y, z, vx, vy, vz, radius, BALL_STEP);
+		t += BALL_STEP;
+	}
+	return { event, t, { x, y, z }, { vx, vy, vz } };
+}
+
+void BallFlight::advanceTo(float t) {
+	float x = location.X, y = location.Y, z = location.Z;
+	float vx = velocity.X, vy = velocity.Y, vz = velocity.Z;
+	while (time < t) {
+		if (t - time <= BALL_STEP) {
+			stepBall(x, y, z, vx, vy, vz, radius, t - time);
+			time = t;
+		} else {
+			stepBall(x, y, z, vx, vy, vz, radius, BALL_STEP);
+			time += BALL_STEP;
+		}
+	}
+	location = { x, y, z };
+	velocity = { vx, vy, vz };
+}
+
+void BallBatch::add(Vec3 location, Vec3 velocity) {
+	x.push_back(location.X);
+	y.push_back(location.Y);
+	z.push_back(location.Z);
+	vx.push_back(velocity.X);
+	vy.push_back(velocity.Y);
+	vz.push_back(velocity.Z);
+}
+
+// Advances balls [0, n) by one step, recording first ground contacts at
+// time t.  Landed balls are stepped with dt = 0, which keeps them in place
+// without a branch.  A ball that goes below the floor is caught on the next
+// step, so floor bounces are skipped.  Returns the number still flying.
+static int stepLanes(size_t n, float t, float radius,
+	float* __restrict x, float* __restrict y, float* __restrict z,
+	float* __restrict vx, float* __restrict vy, float* __restrict vz,
+	float* __restrict land) {
+	int flying = 0;
+	for (size_t i = 0; i < n; i++) {
+		float bx = x[i], by = y[i], bz = z[i], bvx = vx[i], bvy = vy[i], bvz = vz[i];
+		float l = land[i];
+		l = l < 0 && onGround(bz, radius) ? t : l;
+		land[i] = l;
+		flying += l < 0;
+		stepBall<false>(bx, by, bz, bvx, bvy, bvz, radius, l < 0 ? BALL_STEP : 0.0f);
+		x[i] = bx;
+		y[i] = by;
+		z[i] = bz;
+		vx[i] = bvx;
+		vy[i] = bvy;
+		vz[i] = bvz;
+	}
+	return flying;
+}
+
+void predictLandings(BallBatch& balls, float radius, float horizon) {
+	size_t n = balls.size();
+	balls.landTime.assign(n, -1.0f);
+	// Lanes still being stepped, copied so landed balls can be dropped and
+	// the rest packed together; lane i is ball ball[i].
+	std::vector<float> x = balls.x, y = balls.y, z = balls.z, vx = balls.vx, vy = balls.vy, vz = balls.vz;
+	std::vector<float> land(n, -1.0f);
+	std::vector<size_t> ball(n);
+	for (size_t i = 0; i < n; i++) {
+		ball[i] = i;
+	}
+	size_t active = n;
+	// Checks the same times as predictBall: every step until the first at or
+	// past the horizon.  The last pass always copies out what landed.
+	for (float t = 0; active > 0; t += BALL_STEP) {
+		size_t flying = stepLanes(active, t, radius, x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(), land.data());
+		bool last = t >= horizon;
+		if (!last && flying > active * 3 / 4) {
+			continue;
+		}
+		size_t k = 0;
+		for (size_t i = 0; i < active; i++) {
+			if (land[i] >= 0) {
+				balls.landTime[ball[i]] = land[i];
+				balls.x[ball[i]] = x[i];
+				balls.y[ball[i]] = y[i];
+				continue;
+			}
+			x[k] = x[i];
+			y[k] = y[i];
+			z[k] = z[i];
+			vx[k] = vx[i];
+			vy[k] = vy[i];
+			vz[k] = vz[i];
+			land[k] = land[i];
+			ball[k] = ball[i];
+			k++;
+		}
+		active = k;
+		if (last) {
+			break;
+		}
+	}
+}
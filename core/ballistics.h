@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "vec.h"
+
+#include <vector>
+
+// Fixed-step ball flight in a box-shaped soccar arena: gravity, air drag and
+// bounces off the floor, ceiling and walls, with an opening for each goal.
+// Corner and wall curves, spin and car touches are not modeled, so
+// predictions are approximate and should be confirmed against the game.
+
+constexpr float BALL_RADIUS = 92.75f;
+constexpr float BALL_STEP = 1.0f / 120; // s; the physics tick rate
+constexpr float GROUND_CONTACT = 5; // height of the ball's bottom treated as touching the ground
+
+enum BallEvent {
+	BALL_NONE = 0,
+	BALL_GROUND = 1, // z < radius + GROUND_CONTACT
+	BALL_GOAL = 2, // fully over a goal line
+};
+
+struct BallPrediction {
+	BallEvent event; // BALL_NONE if nothing happened within the horizon
+	float time; // seconds from the start; the horizon if BALL_NONE
+	Vec3 location;
+	Vec3 velocity;
+};
+
+// Whether a ball at location is fully over a goal line.
+bool ballInGoal(Vec3 location, float radius = BALL_RADIUS);
+
+// Whether a ball at location is near enough a back wall, or the curved walls
+// and corners predictBall does not model, that it could reach a goal sooner
+// than predicted (or bounce back out of one between snapshots).
+bool ballNearGoalOrCurve(Vec3 location, float radius = BALL_RADIUS);
+
+// Simulates the ball until the first of `events` (BALL_* flags) or until
+// `horizon` seconds have passed.
+BallPrediction predictBall(Vec3 location, Vec3 velocity, float radius, float horizon, int events);
+
+// A ball's flight, advanced a little at a time.
+struct BallFlight {
+	Vec3 location;
+	Vec3 velocity;
+	float radius = BALL_RADIUS;
+	float time = 0; // seconds simulated so far
+
+	// Steps until time reaches t; the last step is shortened to end at t.
+	void advanceTo(float t);
+};
+
+// Balls in structure-of-arrays layout for predicting many at once.  Lanes
+// are stepped together so the compiler can vectorize the step.
+struct BallBatch {
+	void add(Vec3 location, Vec3 velocity);
+	size_t size() const { return x.size(); }
+
+	std::vector<float> x, y, z, vx, vy, vz;
+	// Filled by predictLandings:
+	std::vector<float> landTime; // -1 if the ball did not land within the horizon
+};
+
+// Predicts when and where each ball first touches the ground.  Afterwards x
+// and y hold the landing spot of each ball that landed.
+void predictLandings(BallBatch& balls, float radius, float horizon);
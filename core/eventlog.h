@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Debug events.  The plugin formats them (events.cpp) only when they are
+// printed or dumped, so recording one costs a few stores.
+enum EventId : uint16_t {
+	EVENT_RESUMING,
+	EVENT_QUICK_CHECKPOINT_TAKEN,
+	EVENT_CHECKPOINT_ADDED, // checkpoint number
+	EVENT_CHECKPOINT_REMOVED, // checkpoint number
+	EVENT_CHECKPOINT_LOCKED, // checkpoint number
+	EVENT_CHECKPOINT_UNLOCKED, // checkpoint number
+	EVENT_REMOVE_LOCKED, // checkpoint number
+	EVENT_LOAD_QUICK_CHECKPOINT,
+	EVENT_LOAD_CHECKPOINT, // checkpoint number
+	EVENT_NO_CHECKPOINT,
+	EVENT_BAD_SAVE_VERSION, // file version
+	EVENT_VARIANCE, // ball dir, speed, rotation; car dir, speed, rotation; total
+	EVENT_SIMILAR_MOMENT, // rank, matches, seconds ago, distance
+	EVENT_MARKER, // MarkerKind bits, seconds ago
+	EVENT_ATTEMPT, // attempts kept at its checkpoint, seconds long
+
+	EVENT_COUNT
+};
+
+constexpr int EVENT_MAX_ARGS = 7;
+
+struct EventRecord {
+	uint64_t time; // steady_clock nanoseconds
+	EventId id;
+	uint8_t argc;
+	float args[EVENT_MAX_ARGS];
+};
+
+// Fixed-size ring of the most recent events; older events are overwritten.
+// Not thread-safe: events are recorded and read on the game thread.
+class EventLog {
+public:
+	static constexpr uint64_t CAPACITY = 4096;
+
+	template<typename... Args>
+	void trace(EventId id, Args... args) {
+		static_assert(sizeof...(Args) <= EVENT_MAX_ARGS, "too many event arguments");
+		EventRecord& r = records[written % CAPACITY];
+		r.time = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+		r.id = id;
+		r.argc = uint8_t(sizeof...(Args));
+		int i = 0;
+		((r.args[i++] = float(args)), ...);
+		written++;
+	}
+
+	// Number of events recorded so far, including overwritten ones.
+	uint64_t count() const { return written; }
+
+	// Calls f with each event numbered from `from` on that is still in the
+	// ring, oldest first.
+	template<typename F>
+	void forEach(uint64_t from, F f) const {
+		if (written > CAPACITY && from < written - CAPACITY) {
+			from = written - CAPACITY;
+		}
+		for (uint64_t i = from; i < written; i++) {
+			f(records[i % CAPACITY]);
+		}
+	}
+
+private:
+	EventRecord records[CAPACITY];
+	uint64_t written = 0;
+};
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "vec.h"
+
+// Polynomial sin/cos and atan2 for the batch kernels in variance.h.  They
+// are branch-free (selects only) and call nothing, so loops over them
+// vectorize as wide as the target allows: 4 lanes with SSE2, 8 with AVX2.
+
+constexpr float FAST_SINCOS_MAX_ERROR = 2e-7f; // absolute, for |x| <= 1e4 radians
+constexpr float FAST_ATAN2_MAX_ERROR = 3e-6f; // radians
+
+// sin(x) and cos(x).  Reduces x to [-pi/4, pi/4] around the nearest
+// multiple of pi/2, then uses the Cephes sinf/cosf polynomials.
+inline void fastSinCos(float x, float& s, float& c) {
+	float k = x * (2 / PI_F);
+	int q = int(k + (k >= 0 ? 0.5f : -0.5f));
+	// pi/2 in three parts, the first two short enough that q times them is
+	// exact, so r keeps its low bits.
+	float r = ((x - float(q) * 1.5703125f) - float(q) * 4.837512969970703125e-4f) - float(q) * 7.54978995489188216e-8f;
+	float r2 = r * r;
+	float sr = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+	float cr = 1 - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+	bool swap = (q & 1) != 0;
+	float sv = swap ? cr : sr;
+	float cv = swap ? sr : cr;
+	s = (q & 2) != 0 ? -sv : sv;
+	c = ((q + 1) & 2) != 0 ? -cv : cv;
+}
+
+// atan2(y, x); 0 when both are 0.  A degree 11 odd polynomial for atan on
+// [0, 1], reflected into the other octants.
+inline float fastAtan2(float y, float x) {
+	float ax = x < 0 ? -x : x;
+	float ay = y < 0 ? -y : y;
+	float mx = ax > ay ? ax : ay;
+	float mn = ax > ay ? ay : ax;
+	float a = mx > 0 ? mn / mx : 0.0f;
+	float a2 = a * a;
+	float r = a * (0.99997726f + a2 * (-0.33262347f + a2 * (0.19354346f + a2 * (-0.11643287f + a2 * (0.05265332f + a2 * -0.01172120f)))));
+	r = ay > ax ? PI_F / 2 - r : r;
+	r = x < 0 ? PI_F - r : r;
+	return y < 0 ? -r : r;
+}
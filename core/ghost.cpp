@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ghost.h"
+#include "variance.h"
+
+#include <cmath>
+
+// Octane hitbox.
+constexpr Vec3 CAR_HALF_EXTENT = { 59.0f, 42.1f, 18.08f };
+constexpr Vec3 CAR_OFFSET = { 13.88f, 0, 20.75f };
+
+bool Ghost::select(const AttemptRecorder& attempts, GhostMode mode) {
+	active = false;
+	if (mode == GHOST_OFF || !attempts.recording()) {
+		return false;
+	}
+	const Attempt* best = nullptr;
+	const Attempt* last = nullptr;
+	for (size_t i = 0; i < attempts.size(); i++) {
+		const Attempt& a = attempts[i];
+		if (a.checkpoint != attempts.currentCheckpoint() || a.number == attempts.current()) {
+			continue;
+		}
+		last = &a;
+		if (a.goalTime >= 0 && (best == nullptr || a.goalTime < best->goalTime)) {
+			best = &a;
+		}
+	}
+	const Attempt* a = mode == GHOST_BEST && best != nullptr ? best : last;
+	if (a == nullptr) {
+		return false;
+	}
+	chunks.clear();
+	attempts.forEachChunk(*a, [&](const AttemptSample* s, uint32_t) {
+		chunks.push_back(s);
+	});
+	number = a->number;
+	goalTime = a->goalTime;
+	samples = a->samples;
+	interval = a->interval;
+	active = true;
+	return true;
+}
+
+bool Ghost::at(const AttemptRecorder& attempts, float t, GameState& out) const {
+	if (!active || !attempts.kept(number)) {
+		return false;
+	}
+	// The first sample is taken an interval after play resumes.
+	float offset = std::max(t / interval - 1, 0.0f);
+	size_t i = size_t(offset);
+	if (i + 1 >= samples) {
+		return false;
+	}
+	const size_t CHUNK = AttemptRecorder::CHUNK_SAMPLES;
+	const GameState& lh = chunks[i / CHUNK][i % CHUNK].state;
+	const GameState& rh = chunks[(i + 1) / CHUNK][(i + 1) % CHUNK].state;
+	out = GameState(lh, rh, 1 - (offset - floorf(offset)));
+	return true;
+}
+
+void carBox(const ActorState& car, Vec3 corners[8]) {
+	Quat4 q = RotToQuat({ float(car.rotation.Pitch), float(car.rotation.Yaw), float(car.rotation.Roll) });
+	for (int i = 0; i < 8; i++) {
+		float x = (i & 3) == 1 || (i & 3) == 2 ? 1.0f : -1.0f;
+		float y = (i & 2) ? 1.0f : -1.0f;
+		float z = i < 4 ? -1.0f : 1.0f;
+		Vec3 local = { CAR_OFFSET.X + x * CAR_HALF_EXTENT.X, CAR_OFFSET.Y + y * CAR_HALF_EXTENT.Y, CAR_OFFSET.Z + z * CAR_HALF_EXTENT.Z };
+		corners[i] = car.location + rotateVec(local, q);
+	}
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "attempts.h"
+#include "state.h"
+
+#include <vector>
+
+enum GhostMode {
+	GHOST_OFF = 0,
+	GHOST_BEST = 1, // the attempt that scored soonest, else the most recent
+	GHOST_LAST = 2, // the most recent attempt
+};
+
+// A previous attempt at the checkpoint being played, shown alongside the
+// current one.  select() finds each chunk of the attempt once, so looking
+// up a time is an index into that table and the same interpolation as
+// rewinding, however long the attempt is.
+class Ghost {
+public:
+	// Picks an earlier attempt at the checkpoint of the one being recorded.
+	// Returns false, and shows nothing, if there is none.
+	bool select(const AttemptRecorder& attempts, GhostMode mode);
+	void clear() { active = false; }
+
+	// Sets out to the ghost t seconds after play resumed.  Returns false once
+	// its attempt has ended, or if it was evicted.
+	bool at(const AttemptRecorder& attempts, float t, GameState& out) const;
+
+	bool active = false;
+	uint64_t number = 0; // of the attempt shown
+	float goalTime = -1; // see Attempt
+
+private:
+	std::vector<const AttemptSample*> chunks;
+	uint32_t samples = 0;
+	float interval = 0;
+};
+
+// Corners of the car's hitbox (an Octane's) in world space: bottom four,
+// then top four, each going around the box.
+void carBox(const ActorState& car, Vec3 corners[8]);
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include <stdexcept>
+#include <utility>
+
+// Fixed-capacity ring buffer of the most recent snapshots.  Index 0 is the
+// oldest.  Adding to a full buffer overwrites the oldest entry, so the buffer
+// never allocates after setCapacity().
+template<typename T>
+class HistoryBuffer {
+public:
+	// Keeps the newest min(size(), cap) entries.
+	void setCapacity(size_t cap) {
+		if (cap == cap_) {
+			return;
+		}
+		std::unique_ptr<T[]> resized(cap > 0 ? new T[cap] : nullptr);
+		size_t keep = std::min(size_, cap);
+		for (size_t i = 0; i < keep; i++) {
+			resized[i] = (*this)[size_ - keep + i];
+		}
+		items = std::move(resized);
+		version_++;
+		firstSerial += size_ - keep;
+		cap_ = cap;
+		first = 0;
+		size_ = keep;
+	}
+
+	size_t capacity() const { return cap_; }
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	// Changes whenever entries are added or removed (not when one is written
+	// in place), so derived data can tell when it is stale.
+	uint64_t version() const { return version_; }
+	// Numbers entries in the order they were added, so an entry can be
+	// referred to after older ones are dropped.  Entries dropped by
+	// truncate() have their numbers reused.
+	uint64_t serial(size_t i) const { return firstSerial + i; }
+	uint64_t endSerial() const { return firstSerial + size_; }
+
+	// i < capacity(), so wrapping needs at most one subtraction rather than
+	// a division.
+	T& operator[](size_t i) { return items[wrap(first + i)]; }
+	const T& operator[](size_t i) const { return items[wrap(first + i)]; }
+	T& at(size_t i) {
+		if (i >= size_) {
+			throw std::out_of_range("HistoryBuffer::at");
+		}
+		return (*this)[i];
+	}
+	const T& at(size_t i) const {
+		if (i >= size_) {
+			throw std::out_of_range("HistoryBuffer::at");
+		}
+		return (*this)[i];
+	}
+	T& back() { return (*this)[size_ - 1]; }
+	const T& back() const { return (*this)[size_ - 1]; }
+
+	// Calls f(i, entry) for each entry, oldest first, as two contiguous runs
+	// rather than indexing each entry around the ring.
+	template<typename F>
+	void forEach(F f) const {
+		size_t firstRun = std::min(size_, cap_ - first);
+		for (size_t i = 0; i < firstRun; i++) {
+			f(i, items[first + i]);
+		}
+		for (size_t i = firstRun; i < size_; i++) {
+			f(i, items[i - firstRun]);
+		}
+	}
+
+	// Returns the slot for a new newest entry, overwriting the oldest if full.
+	T& next() {
+		version_++;
+		if (size_ < cap_) {
+			size_++;
+		} else {
+			first = wrap(first + 1);
+			firstSerial++;
+		}
+		return back();
+	}
+	void push_back(const T& t) {
+		if (cap_ > 0) {
+			next() = t;
+		}
+	}
+	template<typename... Args>
+	void emplace_back(Args&&... args) {
+		if (cap_ > 0) {
+			next() = T(std::forward<Args>(args)...);
+		}
+	}
+
+	// Drops the newest entries, keeping the oldest n.
+	void truncate(size_t n) {
+		version_++;
+		size_ = std::min(size_, n);
+	}
+	// Drops the oldest n entries.
+	void dropOldest(size_t n) {
+		n = std::min(size_, n);
+		version_++;
+		first = cap_ > 0 ? (first + n) % cap_ : 0;
+		firstSerial += n;
+		size_ -= n;
+	}
+	void clear() {
+		version_++;
+		first = 0;
+		firstSerial += size_;
+		size_ = 0;
+	}
+	// Replaces the contents with [begin, end); only the newest capacity() are kept.
+	template<typename It>
+	void assign(It begin, It end) {
+		clear();
+		for (; begin != end; ++begin) {
+			push_back(*begin);
+		}
+	}
+
+private:
+	size_t wrap(size_t i) const { return i >= cap_ ? i - cap_ : i; }
+
+	std::unique_ptr<T[]> items;
+	size_t cap_ = 0;
+	size_t first = 0; // index of the oldest entry in items
+	size_t size_ = 0;
+	uint64_t version_ = 0;
+	uint64_t firstSerial = 0; // serial of the oldest entry
+};
+
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "inputs.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr uint64_t BUTTON_JUMP = 0x01;
+constexpr uint64_t BUTTON_ACTIVATE_BOOST = 0x02;
+constexpr uint64_t BUTTON_HOLDING_BOOST = 0x04;
+constexpr uint64_t BUTTON_HANDBRAKE = 0x08;
+
+static uint64_t packAxis(float f) {
+	return uint8_t(int8_t(lrintf(std::clamp(f, -1.0f, 1.0f) * 127)));
+}
+
+static float unpackAxis(uint64_t bits) {
+	return int8_t(uint8_t(bits)) / 127.0f;
+}
+
+uint64_t packInput(const RewindInput& in) {
+	uint64_t buttons = (in.jump ? BUTTON_JUMP : 0) |
+		(in.activateBoost ? BUTTON_ACTIVATE_BOOST : 0) |
+		(in.holdingBoost ? BUTTON_HOLDING_BOOST : 0) |
+		(in.handbrake ? BUTTON_HANDBRAKE : 0);
+	return packAxis(in.throttle) | packAxis(in.steer) << 8 | packAxis(in.pitch) << 16 |
+		packAxis(in.yaw) << 24 | packAxis(in.roll) << 32 | buttons << 40;
+}
+
+RewindInput unpackInput(uint64_t bits) {
+	RewindInput in;
+	in.throttle = unpackAxis(bits);
+	in.steer = unpackAxis(bits >> 8);
+	in.pitch = unpackAxis(bits >> 16);
+	in.yaw = unpackAxis(bits >> 24);
+	in.roll = unpackAxis(bits >> 32);
+	uint64_t buttons = bits >> 40;
+	in.jump = buttons & BUTTON_JUMP;
+	in.activateBoost = buttons & BUTTON_ACTIVATE_BOOST;
+	in.holdingBoost = buttons & BUTTON_HOLDING_BOOST;
+	in.handbrake = buttons & BUTTON_HANDBRAKE;
+	return in;
+}
+
+void InputHistory::record(const HistoryBuffer<GameState>& history, const RewindInput& input) {
+	if (history.empty()) {
+		return;
+	}
+	if (runs_.capacity() != history.capacity()) {
+		runs_.setCapacity(history.capacity());
+	}
+	uint64_t serial = history.endSerial() - 1;
+	if (serial > endSerial) {
+		runs_.clear(); // History was refilled without inputs.
+	}
+	// Drops inputs for snapshots that HistoryBuffer::truncate() removed.
+	while (serial < endSerial && !runs_.empty()) {
+		uint64_t& last = runs_.back();
+		uint64_t drop = std::min(lengthOf(last), endSerial - serial);
+		endSerial -= drop;
+		if (drop == lengthOf(last)) {
+			runs_.truncate(runs_.size() - 1);
+		} else {
+			last -= drop << LENGTH_SHIFT;
+		}
+	}
+	endSerial = serial + 1;
+
+	uint64_t bits = packInput(input);
+	if (!runs_.empty() && (runs_.back() & INPUT_MASK) == bits && lengthOf(runs_.back()) < MAX_LENGTH) {
+		runs_.back() += uint64_t(1) << LENGTH_SHIFT;
+		return;
+	}
+	runs_.push_back(bits);
+}
+
+void InputHistory::clear() {
+	runs_.clear();
+}
+
+bool InputHistory::at(const HistoryBuffer<GameState>& history, size_t index, RewindInput& input) const {
+	if (index >= history.size()) {
+		return false;
+	}
+	uint64_t serial = history.serial(index);
+	if (serial >= endSerial) {
+		return false;
+	}
+	uint64_t start = endSerial;
+	for (size_t i = runs_.size(); i > 0; i--) {
+		start -= lengthOf(runs_[i - 1]);
+		if (serial >= start) {
+			input = unpackInput(runs_[i - 1]);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void writeVec(std::ostream& out, Vec3 v) {
+	out << ',' << v.X << ',' << v.Y << ',' << v.Z;
+}
+
+static void writeRow(std::ostream& out, const GameState& s, float time, const RewindInput* in) {
+	out << time;
+	writeVec(out, s.ball.location);
+	writeVec(out, s.ball.velocity);
+	const ActorState& car = s.car.actorState;
+	writeVec(out, car.location);
+	writeVec(out, car.velocity);
+	out << ',' << car.rotation.Pitch << ',' << car.rotation.Yaw << ',' << car.rotation.Roll;
+	out << ',' << s.car.boostAmount << ',' << s.car.hasDodge;
+	if (in == nullptr) {
+		out << ",,,,,,,,,\n";
+		return;
+	}
+	out << ',' << in->throttle << ',' << in->steer << ',' << in->pitch << ',' << in->yaw << ',' << in->roll <<
+		',' << in->jump << ',' << in->activateBoost << ',' << in->holdingBoost << ',' << in->handbrake << '\n';
+}
+
+void writeHistoryCsv(std::ostream& out, const HistoryBuffer<GameState>& history,
+	const InputHistory& inputs, float interval) {
+	out << "time,ball_x,ball_y,ball_z,ball_vx,ball_vy,ball_vz,"
+		"car_x,car_y,car_z,car_vx,car_vy,car_vz,car_pitch,car_yaw,car_roll,boost_amount,has_dodge,"
+		"throttle,steer,pitch,yaw,roll,jump,activate_boost,holding_boost,handbrake\n";
+	size_t next = 0; // history index of the next row
+	auto row = [&](size_t i, const RewindInput* in) {
+		writeRow(out, history[i], (float(i) - float(history.size() - 1)) * interval, in);
+	};
+	inputs.forEachRun([&](uint64_t first, uint64_t length, uint64_t bits) {
+		RewindInput in = unpackInput(bits);
+		for (uint64_t s = std::max(first, history.serial(0)); s < first + length && s < history.endSerial(); s++) {
+			size_t index = size_t(s - history.serial(0));
+			for (; next < index; next++) {
+				row(next, nullptr);
+			}
+			row(next++, &in);
+		}
+	});
+	for (; next < history.size(); next++) {
+		row(next, nullptr);
+	}
+}
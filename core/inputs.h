@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "history.h"
+#include "state.h"
+
+#include <cstdint>
+#include <ostream>
+
+// The parts of ControllerInput read in rewind mode and recorded with history.
+struct RewindInput {
+	float throttle = 0;
+	float steer = 0;
+	float pitch = 0;
+	float yaw = 0;
+	float roll = 0;
+	bool jump = false;
+	bool activateBoost = false;
+	bool holdingBoost = false;
+	bool handbrake = false;
+};
+
+// Quantizes each axis to 8 bits and packs them with the buttons into the low
+// 48 bits.
+uint64_t packInput(const RewindInput& in);
+RewindInput unpackInput(uint64_t bits);
+
+// The controller input for each snapshot in a history, run-length encoded:
+// each run is one uint64_t, the packed input plus how many snapshots in a row
+// it was held for.  Holds a run per snapshot at worst, so it never loses
+// inputs for snapshots still in history, and never allocates once its
+// capacity follows history's.
+class InputHistory {
+public:
+	// Records input for history's newest snapshot.
+	void record(const HistoryBuffer<GameState>& history, const RewindInput& input);
+	void clear();
+
+	// Sets input to what was held at history[index].  Returns false if it was
+	// not recorded (history was restored from disk, for example).  Walks back
+	// one run at a time from the newest; meant for the rewind position.
+	bool at(const HistoryBuffer<GameState>& history, size_t index, RewindInput& input) const;
+	// Calls f(first serial, length, packed input) for each run, oldest first.
+	// Serials are history's; see HistoryBuffer::serial().
+	template<typename F>
+	void forEachRun(F f) const {
+		uint64_t serial = endSerial;
+		for (size_t i = 0; i < runs_.size(); i++) {
+			serial -= lengthOf(runs_[i]);
+		}
+		for (size_t i = 0; i < runs_.size(); i++) {
+			f(serial, lengthOf(runs_[i]), runs_[i] & INPUT_MASK);
+			serial += lengthOf(runs_[i]);
+		}
+	}
+
+	size_t runs() const { return runs_.size(); }
+	size_t capacity() const { return runs_.capacity(); }
+
+private:
+	static constexpr int LENGTH_SHIFT = 48; // run length - 1 is in the top 16 bits
+	static constexpr uint64_t INPUT_MASK = (uint64_t(1) << LENGTH_SHIFT) - 1;
+	static constexpr uint64_t MAX_LENGTH = uint64_t(1) << (64 - LENGTH_SHIFT);
+
+	static uint64_t lengthOf(uint64_t run) { return (run >> LENGTH_SHIFT) + 1; }
+
+	HistoryBuffer<uint64_t> runs_;
+	uint64_t endSerial = 0; // serial of the snapshot after the newest input
+};
+
+// Writes history with its inputs as CSV, one row per snapshot, for analysis
+// outside the game.  time is seconds before the newest snapshot.
+void writeHistoryCsv(std::ostream& out, const HistoryBuffer<GameState>& history,
+	const InputHistory& inputs, float interval);
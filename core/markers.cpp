@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "markers.h"
+
+#include <cstring>
+
+// Change in the ball's velocity between snapshots that counts as a bounce;
+// well above what gravity and drag do over MAX_SNAPSHOT_INTERVAL.
+constexpr float BOUNCE_DELTA_V = 150; // uu/s
+
+static const struct {
+	const char* name;
+	uint8_t kind;
+} MARKER_NAMES[] = {
+	{ "touch", MARK_TOUCH },
+	{ "bounce", MARK_BOUNCE },
+	{ "jump", MARK_JUMP },
+	{ "dodge", MARK_DODGE },
+	{ "land", MARK_LAND },
+	{ "takeoff", MARK_TAKEOFF },
+	{ "boost", MARK_BOOST_START },
+	{ "boost_end", MARK_BOOST_END },
+};
+
+uint8_t markerKind(const char* name) {
+	for (auto& n : MARKER_NAMES) {
+		if (strcmp(n.name, name) == 0) {
+			return n.kind;
+		}
+	}
+	return 0;
+}
+
+void MarkerIndex::detect(const HistoryBuffer<GameState>& history, int wheelContacts, bool touched) {
+	if (history.empty()) {
+		return;
+	}
+	size_t cap = history.capacity() / SNAPSHOTS_PER_MARKER;
+	if (markers.capacity() != cap) {
+		markers.setCapacity(cap);
+	}
+	uint64_t serial = history.endSerial() - 1;
+	const GameState& s = history.back();
+	bool onGround = wheelContacts > 0;
+	bool boosting = s.car.boosting != 0;
+	// Each push changes the version once; any other change means history
+	// was rebuilt under us, perhaps by HistoryBuffer::truncate() dropping
+	// snapshots that have markers.
+	if (history.version() != lastVersion + 1) {
+		continuous = false;
+		while (!markers.empty() && markers.back().serial >= serial) {
+			markers.truncate(markers.size() - 1);
+		}
+	}
+	if (continuous) {
+		uint8_t kinds = 0;
+		Vec3 dv = s.ball.velocity - lastBallVelocity;
+		if (touched) {
+			kinds |= MARK_TOUCH;
+		} else if (dot(dv, dv) > BOUNCE_DELTA_V * BOUNCE_DELTA_V) {
+			kinds |= MARK_BOUNCE;
+		}
+		if (lastJumped < 0 && s.car.lastJumped >= 0) {
+			kinds |= MARK_JUMP;
+		} else if (lastHasDodge && !s.car.hasDodge && s.car.lastJumped < MAX_DODGE_TIME) {
+			kinds |= MARK_DODGE; // not just the dodge timer running out
+		}
+		if (onGround != lastOnGround) {
+			kinds |= onGround ? MARK_LAND : MARK_TAKEOFF;
+		}
+		if (boosting != lastBoosting) {
+			kinds |= boosting ? MARK_BOOST_START : MARK_BOOST_END;
+		}
+		if (kinds != 0) {
+			markers.push_back({ serial, kinds });
+		}
+	}
+	continuous = true;
+	lastVersion = history.version();
+	lastBallVelocity = s.ball.velocity;
+	lastJumped = s.car.lastJumped;
+	lastHasDodge = s.car.hasDodge;
+	lastBoosting = boosting;
+	lastOnGround = onGround;
+}
+
+void MarkerIndex::clear() {
+	markers.clear();
+	continuous = false;
+}
+
+size_t MarkerIndex::lowerBound(uint64_t serial) const {
+	size_t lo = 0;
+	size_t hi = markers.size();
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (markers[mid].serial < serial) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+uint8_t MarkerIndex::previous(const HistoryBuffer<GameState>& history, size_t& index, uint8_t kinds) const {
+	if (index > history.size()) {
+		return 0;
+	}
+	for (size_t i = lowerBound(history.serial(index)); i > 0; i--) {
+		const Marker& m = markers[i - 1];
+		if (m.serial < history.serial(0)) {
+			return 0; // History has dropped the rest.
+		}
+		if (m.kinds & kinds) {
+			index = size_t(m.serial - history.serial(0));
+			return m.kinds;
+		}
+	}
+	return 0;
+}
+
+uint8_t MarkerIndex::next(const HistoryBuffer<GameState>& history, size_t& index, uint8_t kinds) const {
+	if (index >= history.size()) {
+		return 0;
+	}
+	for (size_t i = lowerBound(history.serial(index) + 1); i < markers.size(); i++) {
+		const Marker& m = markers[i];
+		if (m.serial >= history.endSerial()) {
+			return 0; // Truncated from history.
+		}
+		if (m.kinds & kinds) {
+			index = size_t(m.serial - history.serial(0));
+			return m.kinds;
+		}
+	}
+	return 0;
+}
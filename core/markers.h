@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "history.h"
+#include "state.h"
+
+#include <cstdint>
+
+// Moments worth stopping at while rewinding, detected as each snapshot is
+// recorded by comparing it with the one before.
+enum MarkerKind : uint8_t {
+	MARK_TOUCH = 0x01, // the car touched the ball
+	MARK_BOUNCE = 0x02, // the ball's velocity jumped without a touch
+	MARK_JUMP = 0x04,
+	MARK_DODGE = 0x08, // second jump or flip
+	MARK_LAND = 0x10, // wheels touched down
+	MARK_TAKEOFF = 0x20, // wheels left the ground
+	MARK_BOOST_START = 0x40,
+	MARK_BOOST_END = 0x80,
+
+	MARK_ALL = 0xff
+};
+
+// Returns the kind named name ("touch", "jump", ...), or 0.
+uint8_t markerKind(const char* name);
+
+struct Marker {
+	uint64_t serial; // of the snapshot, per HistoryBuffer::serial()
+	uint8_t kinds;
+};
+
+// Markers for the snapshots in a history, oldest first.  Holds at most one
+// per SNAPSHOTS_PER_MARKER snapshots on average; beyond that the oldest are
+// lost.  Like history, never allocates once its capacity is set.
+class MarkerIndex {
+public:
+	static constexpr size_t SNAPSHOTS_PER_MARKER = 4;
+
+	// Finds the markers for history's newest snapshot.  wheelContacts is the
+	// car's when it was captured and touched is whether a car touched the
+	// ball since the last snapshot.
+	void detect(const HistoryBuffer<GameState>& history, int wheelContacts, bool touched);
+	// The next snapshot does not follow on from the last (history was
+	// reloaded or play resumed from somewhere else), so nothing changed
+	// between them.
+	void restart() { continuous = false; }
+	void clear();
+
+	// Sets index to the nearest snapshot in history strictly before (or after)
+	// index with a marker of one of kinds, and returns that marker's kinds; 0
+	// if there is none.  previous() also takes history.size(), for the end.
+	// O(log n) to find the nearest marker, then one step per marker skipped
+	// for not matching kinds.
+	uint8_t previous(const HistoryBuffer<GameState>& history, size_t& index, uint8_t kinds = MARK_ALL) const;
+	uint8_t next(const HistoryBuffer<GameState>& history, size_t& index, uint8_t kinds = MARK_ALL) const;
+
+	size_t size() const { return markers.size(); }
+	size_t capacity() const { return markers.capacity(); }
+
+private:
+	// The first marker with a serial at or after serial.
+	size_t lowerBound(uint64_t serial) const;
+
+	HistoryBuffer<Marker> markers;
+	// What the previous snapshot looked like.
+	bool continuous = false;
+	uint64_t lastVersion = 0; // history's, after the last snapshot
+	Vec3 lastBallVelocity;
+	float lastJumped = -1;
+	bool lastHasDodge = false;
+	bool lastBoosting = false;
+	bool lastOnGround = false;
+};
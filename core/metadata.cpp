@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "metadata.h"
+
+#include "ballistics.h"
+
+#include <algorithm>
+#include <thread>
+
+constexpr float ZONE_EDGE = 5120.0f / 3; // |Y| where midfield ends
+constexpr float CAR_DRIVE_SPEED = 1410; // uu/s; top speed without boost
+constexpr size_t META_MIN_PER_THREAD = 256; // fewer are not worth a thread
+
+static const char META_MAGIC[4] = { 'C', 'P', 'T', 'M' };
+
+// Computes [begin, end); landing spots are predicted as one batch.
+static void computeRange(const GameState* states, CheckpointMeta* out, size_t begin, size_t end) {
+	BallBatch balls;
+	for (size_t i = begin; i < end; i++) {
+		const ActorState& ball = states[i].ball;
+		const CarState& car = states[i].car;
+		CheckpointMeta& m = out[i];
+		m.zone = ball.location.Y < -ZONE_EDGE ? ZONE_DEFENSE :
+			ball.location.Y > ZONE_EDGE ? ZONE_OFFENSE : ZONE_MIDFIELD;
+		m.side = ball.location.X < 0 ? -1 : 1;
+		m.hasDodge = car.hasDodge;
+		m.ballHeight = ball.location.Z - BALL_RADIUS;
+		m.ballSpeed = ball.velocity.magnitude();
+		m.carSpeed = car.actorState.velocity.magnitude();
+		Vec3 toBall = ball.location - car.actorState.location;
+		float distance = toBall.magnitude();
+		float closing = distance > 0 ? dot(car.actorState.velocity, toBall) / distance : 0;
+		m.timeToBall = std::max(distance - BALL_RADIUS, 0.0f) / std::max(closing, CAR_DRIVE_SPEED);
+		balls.add(ball.location, ball.velocity);
+	}
+	predictLandings(balls, BALL_RADIUS, META_HORIZON);
+	for (size_t i = begin; i < end; i++) {
+		CheckpointMeta& m = out[i];
+		m.landTime = balls.landTime[i - begin];
+		m.lands = m.landTime >= 0;
+		m.landX = balls.x[i - begin];
+		m.landY = balls.y[i - begin];
+	}
+}
+
+void computeMeta(const GameState* states, size_t n, CheckpointMeta* out, unsigned threads) {
+	threads = unsigned(std::clamp<size_t>(n / META_MIN_PER_THREAD, 1, std::max(threads, 1u)));
+	size_t per = (n + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for (unsigned t = 1; t < threads; t++) {
+		workers.emplace_back(computeRange, states, out, t * per, std::min(n, (t + 1) * per));
+	}
+	computeRange(states, out, 0, std::min(n, per));
+	for (auto& w : workers) {
+		w.join();
+	}
+}
+
+size_t updateMeta(const std::vector<GameState>& checkpoints, MetaCache& cache, std::vector<CheckpointMeta>& meta, unsigned threads) {
+	meta.resize(checkpoints.size());
+	std::vector<size_t> missing;
+	std::vector<GameState> states;
+	for (size_t i = 0; i < checkpoints.size(); i++) {
+		auto it = cache.find(checkpoints[i].hash());
+		if (it != cache.end()) {
+			meta[i] = it->second;
+			continue;
+		}
+		missing.push_back(i);
+		states.push_back(checkpoints[i]);
+	}
+	std::vector<CheckpointMeta> computed(states.size());
+	computeMeta(states.data(), states.size(), computed.data(), threads);
+	for (size_t j = 0; j < missing.size(); j++) {
+		meta[missing[j]] = computed[j];
+		cache[states[j].hash()] = computed[j];
+	}
+	return missing.size();
+}
+
+size_t cacheMeta(const std::vector<GameState>& states, MetaCache& cache, unsigned threads) {
+	std::vector<GameState> missing;
+	for (const GameState& s : states) {
+		// Holds the key, so repeated states are computed once.
+		if (cache.emplace(s.hash(), CheckpointMeta()).second) {
+			missing.push_back(s);
+		}
+	}
+	std::vector<CheckpointMeta> computed(missing.size());
+	computeMeta(missing.data(), missing.size(), computed.data(), threads);
+	for (size_t j = 0; j < missing.size(); j++) {
+		cache[missing[j].hash()] = computed[j];
+	}
+	return missing.size();
+}
+
+bool lookupMeta(const std::vector<uint64_t>& keys, const MetaCache& cache, std::vector<CheckpointMeta>& meta) {
+	meta.resize(keys.size());
+	for (size_t i = 0; i < keys.size(); i++) {
+		auto it = cache.find(keys[i]);
+		if (it == cache.end()) {
+			meta.clear();
+			return false;
+		}
+		meta[i] = it->second;
+	}
+	return true;
+}
+
+bool readMetaFile(std::istream& in, MetaCache& cache) {
+	cache.clear();
+	char magic[sizeof(META_MAGIC)] = {};
+	uint32_t version = 0;
+	uint32_t entrySize = 0;
+	uint32_t count = 0;
+	in.read(magic, sizeof(magic));
+	readPOD(in, version);
+	readPOD(in, entrySize);
+	readPOD(in, count);
+	if (!std::equal(magic, magic + sizeof(magic), META_MAGIC) ||
+		version != META_FILE_VERSION || entrySize != sizeof(CheckpointMeta)) {
+		return false;
+	}
+	cache.reserve(std::min<uint32_t>(count, 1 << 20)); // Bounded in case the file is corrupt.
+	for (uint32_t i = 0; i < count; i++) {
+		uint64_t hash;
+		CheckpointMeta m;
+		if (!in.read(reinterpret_cast<char*>(&hash), sizeof(hash)) ||
+			!in.read(reinterpret_cast<char*>(&m), sizeof(m))) {
+			break;
+		}
+		cache[hash] = m;
+	}
+	return true;
+}
+
+void writeMetaFile(std::ostream& out, const std::vector<uint64_t>& keys, const std::vector<CheckpointMeta>& meta) {
+	out.write(META_MAGIC, sizeof(META_MAGIC));
+	writePOD(out, META_FILE_VERSION);
+	uint32_t entrySize = sizeof(CheckpointMeta);
+	writePOD(out, entrySize);
+	uint32_t count = uint32_t(std::min(keys.size(), meta.size()));
+	writePOD(out, count);
+	for (uint32_t i = 0; i < count; i++) {
+		writePOD(out, keys[i]);
+		writePOD(out, meta[i]);
+	}
+}
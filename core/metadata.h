@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "state.h"
+
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+// Features derived from each checkpoint, computed once when checkpoints are
+// loaded or saved so that filtering, sorting and scheduling can use them
+// without looking at the states again.
+
+enum FieldZone : uint8_t {
+	ZONE_DEFENSE = 0, // ball in the third of the field nearest the blue goal
+	ZONE_MIDFIELD = 1,
+	ZONE_OFFENSE = 2,
+};
+
+constexpr float META_HORIZON = 10; // s; landings later than this are not predicted
+
+struct CheckpointMeta {
+	uint8_t zone; // FieldZone of the ball
+	int8_t side; // sign of the ball's X; mirror() flips it
+	bool hasDodge;
+	bool lands; // the ball touches the ground within META_HORIZON
+	float ballHeight; // of the ball's bottom above the ground
+	float ballSpeed;
+	float carSpeed;
+	float timeToBall; // straight-line estimate of when the car can reach the ball
+	float landTime; // -1 if !lands
+	float landX;
+	float landY;
+};
+
+// Metadata by GameState::hash(), so entries stay valid however the
+// checkpoint file is reordered or edited.
+using MetaCache = std::unordered_map<uint64_t, CheckpointMeta>;
+
+// Computes metadata for states [0, n) on up to `threads` threads.
+void computeMeta(const GameState* states, size_t n, CheckpointMeta* out, unsigned threads);
+
+// Sets meta to the metadata of each checkpoint, taking it from cache where
+// possible and computing (and caching) the rest.  Returns how many were
+// computed.
+size_t updateMeta(const std::vector<GameState>& checkpoints, MetaCache& cache, std::vector<CheckpointMeta>& meta, unsigned threads);
+// Computes and caches the metadata of the states not in cache yet.  Returns
+// how many were computed.
+size_t cacheMeta(const std::vector<GameState>& states, MetaCache& cache, unsigned threads);
+// Sets meta to the cached metadata of each key (a GameState::hash()).
+// Returns false, leaving meta empty, if one is not cached.
+bool lookupMeta(const std::vector<uint64_t>& keys, const MetaCache& cache, std::vector<CheckpointMeta>& meta);
+
+// The cache is saved next to the checkpoint file; it is only meant to be read
+// back by the same build that wrote it.
+constexpr uint32_t META_FILE_VERSION = 1;
+
+// Returns false, leaving cache empty, if the stream is not a metadata file of
+// this version.
+bool readMetaFile(std::istream& in, MetaCache& cache);
+// Writes the entries for keys (GameState::hash() of each checkpoint) only.
+void writeMetaFile(std::ostream& out, const std::vector<uint64_t>& keys, const std::vector<CheckpointMeta>& meta);
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "mirrors.h"
+
+void MirrorCache::invalidate() {
+	ready.assign(ready.size(), false);
+	count = 0;
+}
+
+// If the block did not match the checkpoints before, sync() drops it instead.
+void MirrorCache::inserted(const std::vector<GameState>& checkpoints, size_t i) {
+	if (twins.size() + 1 != checkpoints.size()) {
+		return;
+	}
+	twins.insert(twins.begin() + i, GameState());
+	ready.insert(ready.begin() + i, false);
+}
+
+void MirrorCache::removed(const std::vector<GameState>& checkpoints, size_t i) {
+	if (twins.size() != checkpoints.size() + 1) {
+		return;
+	}
+	count -= ready[i];
+	twins.erase(twins.begin() + i);
+	ready.erase(ready.begin() + i);
+}
+
+void MirrorCache::sync(const std::vector<GameState>& checkpoints) {
+	if (twins.size() == checkpoints.size()) {
+		return;
+	}
+	twins.resize(checkpoints.size());
+	ready.assign(checkpoints.size(), false);
+	count = 0;
+}
+
+const GameState& MirrorCache::mirrored(const std::vector<GameState>& checkpoints, size_t i) {
+	sync(checkpoints);
+	if (!ready[i]) {
+		twins[i] = checkpoints[i].mirror();
+		ready[i] = true;
+		count++;
+	}
+	return twins[i];
+}
+
+void MirrorCache::fill(const std::vector<GameState>& checkpoints) {
+	sync(checkpoints);
+	for (size_t i = 0; i < checkpoints.size() && count < checkpoints.size(); i++) {
+		mirrored(checkpoints, i);
+	}
+}
+
+std::vector<size_t> MirrorCache::missing(const std::vector<GameState>& checkpoints) {
+	sync(checkpoints);
+	std::vector<size_t> indices;
+	indices.reserve(checkpoints.size() - count);
+	for (size_t i = 0; i < ready.size(); i++) {
+		if (!ready[i]) {
+			indices.push_back(i);
+		}
+	}
+	return indices;
+}
+
+void MirrorCache::adopt(const std::vector<GameState>& checkpoints, const std::vector<size_t>& indices, const std::vector<GameState>& mirrors) {
+	sync(checkpoints);
+	for (size_t j = 0; j < indices.size() && j < mirrors.size(); j++) {
+		size_t i = indices[j];
+		if (i < ready.size() && !ready[i]) {
+			twins[i] = mirrors[j];
+			ready[i] = true;
+			count++;
+		}
+	}
+}
+
+size_t MirrorCache::memoryUsage() const {
+	return twins.capacity() * sizeof(GameState) + ready.capacity() / 8;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "state.h"
+
+#include <vector>
+
+// Each checkpoint's mirror image, computed once and kept until the
+// checkpoints change, so a mirrored load only picks which state to load.
+// Mirrors are kept in one block, in checkpoint order.
+class MirrorCache {
+public:
+	// Checkpoints were replaced, reordered or edited.
+	void invalidate();
+	// checkpoints[i] was just added or removed; the other mirrors are kept.
+	void inserted(const std::vector<GameState>& checkpoints, size_t i);
+	void removed(const std::vector<GameState>& checkpoints, size_t i);
+	// checkpoints[i] mirrored; computed on first use.
+	const GameState& mirrored(const std::vector<GameState>& checkpoints, size_t i);
+	// Computes every mirror not computed yet.
+	void fill(const std::vector<GameState>& checkpoints);
+	// Indices of the mirrors not computed yet, to be computed elsewhere.
+	std::vector<size_t> missing(const std::vector<GameState>& checkpoints);
+	// Takes mirrors[j] as the mirror of checkpoints[indices[j]], unless it was
+	// computed here in the meantime.
+	void adopt(const std::vector<GameState>& checkpoints, const std::vector<size_t>& indices, const std::vector<GameState>& mirrors);
+	size_t computed() const { return count; }
+	size_t memoryUsage() const;
+
+private:
+	// Matches the block's size to checkpoints, dropping mirrors if it changed.
+	void sync(const std::vector<GameState>& checkpoints);
+
+	std::vector<GameState> twins; // twins[i] mirrors checkpoints[i] if ready[i]
+	std::vector<bool> ready;
+	size_t count = 0; // of ready
+};
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static int log2Floor(uint64_t v) {
+#ifdef _MSC_VER
+	unsigned long i;
+	return _BitScanReverse64(&i, v) ? int(i) : 0;
+#else
+	return v == 0 ? 0 : 63 - __builtin_clzll(v);
+#endif
+}
+
+void Log2Histogram::add(uint64_t value) {
+	int i = std::min(log2Floor(value), BUCKETS - 1);
+	counts[i].fetch_add(1, std::memory_order_relaxed);
+	uint64_t m = max_.load(std::memory_order_relaxed);
+	while (value > m && !max_.compare_exchange_weak(m, value, std::memory_order_relaxed)) {
+	}
+}
+
+void Log2Histogram::reset() {
+	for (auto& c : counts) {
+		c.store(0, std::memory_order_relaxed);
+	}
+	max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Log2Histogram::count() const {
+	uint64_t n = 0;
+	for (auto& c : counts) {
+		n += c.load(std::memory_order_relaxed);
+	}
+	return n;
+}
+
+double Log2Histogram::percentile(double p) const {
+	uint64_t snapshot[BUCKETS];
+	uint64_t n = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		snapshot[i] = counts[i].load(std::memory_order_relaxed);
+		n += snapshot[i];
+	}
+	if (n == 0) {
+		return 0;
+	}
+	double rank = p * n;
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		if (snapshot[i] == 0 || seen + snapshot[i] < rank) {
+			seen += snapshot[i];
+			continue;
+		}
+		double lo = i == 0 ? 0 : double(uint64_t(1) << i);
+		double hi = std::min(double(uint64_t(1) << (i + 1)), double(max()));
+		return lo + (hi - lo) * (rank - seen) / snapshot[i];
+	}
+	return double(max());
+}
+
+static const char* STAGE_NAMES[PROFILE_STAGES] = {
+	"tick", "record", "rewind", "variance", "apply", "save", "render",
+};
+
+const char* profileStageName(ProfileStage stage) {
+	return STAGE_NAMES[stage];
+}
+
+void Profiler::reset() {
+	for (auto& s : stages) {
+		s.reset();
+	}
+	tickAllocations.reset();
+}
+
+static void writeRow(std::ostream& out, const char* name, const Log2Histogram& h, double scale) {
+	char row[160];
+	snprintf(row, sizeof(row), "%s,%llu,%.3f,%.3f,%.3f", name, (unsigned long long)h.count(),
+		h.percentile(0.5) * scale, h.percentile(0.99) * scale, h.max() * scale);
+	out << row;
+	for (int i = 0; i < Log2Histogram::BUCKETS; i++) {
+		out << ',' << h.bucket(i);
+	}
+	out << '\n';
+}
+
+void Profiler::writeCSV(std::ostream& out) const {
+	out << "stage,count,p50,p99,max";
+	for (int i = 0; i < Log2Histogram::BUCKETS; i++) {
+		out << ",b" << i;
+	}
+	out << '\n';
+	for (int i = 0; i < PROFILE_STAGES; i++) {
+		writeRow(out, profileStageName(ProfileStage(i)), stages[i], 1e-3);
+	}
+	writeRow(out, "allocations_per_tick", tickAllocations, 1);
+}
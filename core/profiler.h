@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Histogram with power-of-two buckets: bucket 0 counts 0 and 1, bucket i
+// counts [2^i, 2^(i+1)).  add() is lock-free and may be called from any
+// thread; readers see a slightly stale but consistent-enough view.
+class Log2Histogram {
+public:
+	static constexpr int BUCKETS = 40;
+
+	void add(uint64_t value);
+	void reset();
+
+	uint64_t count() const;
+	uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+	// Estimated value at fraction p (0..1) of the samples, interpolated
+	// within the bucket; 0 if empty.
+	double percentile(double p) const;
+	uint64_t bucket(int i) const { return counts[i].load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> counts[BUCKETS] = {};
+	std::atomic<uint64_t> max_ = 0;
+};
+
+// The hot paths timed by the profiler.
+enum ProfileStage {
+	PROFILE_TICK, // OnPreAsync
+	PROFILE_RECORD,
+	PROFILE_REWIND,
+	PROFILE_VARIANCE,
+	PROFILE_APPLY, // applyGame
+	PROFILE_SAVE, // saveCheckpointFile
+	PROFILE_RENDER,
+	PROFILE_STAGES
+};
+
+const char* profileStageName(ProfileStage stage);
+
+// Latency (ns) per stage and allocations per tick.  Nothing is recorded
+// unless enabled, so timers cost a branch when profiling is off.
+class Profiler {
+public:
+	void reset();
+	// Writes one CSV row per stage (times in microseconds) and one for
+	// allocations per tick, followed by the bucket counts.
+	void writeCSV(std::ostream& out) const;
+
+	bool enabled = false;
+	Log2Histogram stages[PROFILE_STAGES];
+	Log2Histogram tickAllocations;
+};
+
+// Records the time from construction to destruction in a profiler stage.
+class ScopedTimer {
+public:
+	ScopedTimer(Profiler& profiler, ProfileStage stage) : hist(profiler.enabled ? &profiler.stages[stage] : nullptr) {
+		if (hist != nullptr) {
+			start = std::chrono::steady_clock::now();
+		}
+	}
+	~ScopedTimer() {
+		if (hist != nullptr) {
+			hist->add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+		}
+	}
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	Log2Histogram* hist;
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "random.h"
+#include "vec.h"
+
+#include <cmath>
+
+static uint64_t rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+// Spreads a seed over the state, so nearby seeds give unrelated sequences.
+static uint64_t splitmix64(uint64_t& x) {
+	uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+Rng Rng::stream(uint64_t seed, uint64_t id) {
+	uint64_t x = id;
+	return Rng(seed ^ splitmix64(x));
+}
+
+void Rng::reseed(uint64_t seed) {
+	for (auto& word : s) {
+		word = splitmix64(seed); // Never all zero.
+	}
+}
+
+uint64_t Rng::next() {
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+uint64_t Rng::below(uint64_t n) {
+	// Rejects the top partial copy of [0, n) so every value is equally likely.
+	uint64_t limit = (0 - n) % n;
+	uint64_t x;
+	do {
+		x = next();
+	} while (x < limit);
+	return x % n;
+}
+
+void Rng::fillUniform(float* out, size_t n, float min, float max) {
+	float scale = 0x1.0p-24f * (max - min);
+	for (size_t i = 0; i < n; i++) {
+		out[i] = min + float(next() >> 40) * scale;
+	}
+}
+
+void Rng::fillNormal(float* out, size_t n, float mean, float stddev) {
+	for (size_t i = 0; i < n; i += 2) {
+		uint64_t bits = next();
+		// 1 - u keeps the log finite.
+		float u = 1 - float(bits >> 40) * 0x1.0p-24f;
+		float v = float(bits & 0xFFFFFF) * 0x1.0p-24f;
+		float r = sqrtf(-2 * logf(u)) * stddev;
+		float a = 2 * PI_F * v;
+		out[i] = mean + r * cosf(a);
+		if (i + 1 < n) {
+			out[i + 1] = mean + r * sinf(a);
+		}
+	}
+}
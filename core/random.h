@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// xoshiro256** (Blackman and Vigna): small, fast and good enough for drills.
+// The same seed always gives the same sequence, unlike BakkesMod's random()
+// or rand().
+class Rng {
+public:
+	explicit Rng(uint64_t seed = 0) { reseed(seed); }
+	// A generator for stream id under seed (e.g. one per drill), independent
+	// of the others and of how many numbers they have used.
+	static Rng stream(uint64_t seed, uint64_t id);
+
+	void reseed(uint64_t seed);
+	uint64_t next();
+	// Uniform in [0, 1).
+	double unit() { return double(next() >> 11) * 0x1.0p-53; }
+	// Uniform in [min, max).
+	float uniform(float min, float max) { return min + float(next() >> 40) * 0x1.0p-24f * (max - min); }
+	// Uniform in [0, n); n must not be 0.
+	uint64_t below(uint64_t n);
+	// Fills out with n uniform variates in [min, max).
+	void fillUniform(float* out, size_t n, float min, float max);
+	// Fills out with n normal variates (Box-Muller, two per pair of draws).
+	void fillNormal(float* out, size_t n, float mean = 0, float stddev = 1);
+
+private:
+	uint64_t s[4];
+};
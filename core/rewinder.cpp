@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "rewinder.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float RESET_HORIZON = 10; // s; predict no further than this
+constexpr float RESET_LEAD = 0.05f; // s; start checking this long before the predicted event
+constexpr float FUTURE_TIME = 5; // s; how far past the end of history to predict
+constexpr int FUTURE_STEPS_PER_TICK = 24; // ball steps predicted per rewind(); ~0.2 s
+
+void Rewinder::load(const GameState& s, uint64_t checkpoint) {
+	finishAttempt();
+	loadedCheckpoint = checkpoint;
+	latest = s;
+	rewindState.virtualTimeOffset = 0;
+	rewindState.holdingFor = 0;
+	rewindState.atCheckpoint = false;
+	rewindState.justDeletedCheckpoint = false;
+	rewindState.justLoadedQuickCheckpoint = false;
+	rewindState.deleting = false;
+	rewindState.buttonsDown = 0x7f;
+	hasQuickCheckpoint = false;
+	playingFromCheckpoint = true; // not playing yet but must resume eventually.
+	resetScheduled = false;
+	futureValid = false;
+}
+
+bool Rewinder::rewind(World& world, float now, const RewindInput& ci) {
+	if (previewFuture) {
+		extendFuture(world);
+	}
+	float elapsed = std::min(now - lastRewindTime, 0.03f);
+	if (elapsed < 0) {
+		lastRewindTime = now;
+		return false;  // Ignored whatever inputs may have happened to exit mode; do not apply state.
+	}
+	if (elapsed < 0.01f) {
+		return false;  // Ignored whatever inputs may have happened to exit mode; do not apply state.
+	}
+	lastRewindTime = now;
+	int buttonsDown = (std::abs(ci.throttle) > 0.1 ? 0x01 : 0) |
+		(std::abs(ci.roll) > 0.1 ? 0x02 : 0) |
+		(ci.handbrake ? 0x04 : 0) |
+		(ci.jump ? 0x08 : 0) |
+		(ci.activateBoost ? 0x10 : 0) |
+		(ci.holdingBoost ? 0x20 : 0) |
+		((rewindState.atCheckpoint || rewindState.justLoadedQuickCheckpoint) && std::abs(ci.steer) >= .05 ? 0x40 : 0) |
+		((rewindState.atCheckpoint || rewindState.justLoadedQuickCheckpoint || std::abs(ci.pitch) >= .7) && std::abs(ci.pitch) >= .05 ? 0x80 : 0);
+	// See if we should exit rewind mode due to input.
+	if (buttonsDown != 0) {
+		if ((buttonsDown > rewindState.buttonsDown && now - lastRecordTime > 0.1f) ||
+			now - lastRecordTime > 0.5f) {
+			if (events != nullptr) {
+				events->trace(EVENT_RESUMING);
+			}
+			rewindMode = false;
+			freezeBall = false;
+			resetScheduled = false;
+			futureValid = false;
+			markers.restart(); // Play goes on from latest, not the end of history.
+			if (playingFromCheckpoint) {
+				attempts.start(latest.hash(), interval);
+				attemptStart = now;
+				attempting = true;
+				outcome = AttemptOutcome();
+				attemptCheckpoint = rewindState.atCheckpoint ? loadedCheckpoint : 0;
+			}
+			world.frozenChanged(false, false);
+			lastRecordTime = now;
+			dodgeExpiration = (latest.car.hasDodge && latest.car.lastJumped != -1) ? (now + MAX_DODGE_TIME - latest.car.lastJumped) : 0;
+			if (!rewindState.atCheckpoint) {
+				if (events != nullptr) {
+					events->trace(EVENT_QUICK_CHECKPOINT_TAKEN);
+				}
+				hasQuickCheckpoint = true;
+				quickCheckpoint = latest;
+				if (deleteFutureHistory) {
+					size_t current = std::clamp<size_t>(
+						history.size() - 1 + size_t(ceil(rewindState.virtualTimeOffset / interval)),
+						0, history.size() - 1);
+					history.truncate(current);
+				}
+			}
+			return false; // Leaving rewind; do not apply state.
+		}
+		rewindState.buttonsDown = buttonsDown;
+		return true; // Staying in rewind; apply state.
+	}
+	rewindState.buttonsDown = buttonsDown;
+
+	// Determine how much to rewind / advance time.
+	if (std::abs(ci.steer) < .05f) { // Ignore slight input; keep current game state.
+		return true; // Ignoring input; apply state.
+	}
+	rewindState.deleting = false;
+	if (ci.steer < -.95 && rewindState.holdingFor <= 0) {
+		rewindState.holdingFor -= elapsed;
+	} else if (ci.steer > .95 && rewindState.holdingFor >= 0) {
+		rewindState.holdingFor += elapsed;
+	} else {
+		rewindState.holdingFor = 0;
+	}
+	float factor = std::clamp(std::abs(rewindState.holdingFor) * 2, 1.0f, 10.0f);
+
+	// How much (in seconds) to move "current" (positive or negative)
+	float deltaElapsed = factor * elapsed * ci.steer; // full left = 2-5 seconds/second
+
+	rewindState.virtualTimeOffset = std::clamp(
+		rewindState.virtualTimeOffset + deltaElapsed, -interval * history.size(),
+		previewFuture ? interval * future.size() : .0f);
+	if (rewindState.virtualTimeOffset > 0) {
+		float futureOffset = rewindState.virtualTimeOffset / interval;
+		size_t next = size_t(futureOffset);
+		if (next >= future.size()) {
+			latest = future.back();
+			return true; // Apply new state.
+		}
+		const GameState& prev = next == 0 ? history.back() : future[next - 1];
+		latest = GameState(prev, future[next], 1 - (futureOffset - floor(futureOffset)));
+		return true; // Apply new state.
+	}
+	float historyOffset = rewindState.virtualTimeOffset / interval;
+	size_t current = std::clamp<size_t>(
+		history.size() + size_t(floor(historyOffset)), 0, history.size() - 1);
+	if (current < (history.size() - 1) /* && NEED TO INTERPOLATE */) {
+		float advancePct = 1 - (historyOffset - floor(historyOffset));
+		latest = GameState(history.at(current), history.at(current+1), advancePct);
+		return true; // Apply new state.
+	}
+	latest = history.at(current);
+	return true; // Apply new state.
+}
+
+void Rewinder::record(World& world, float now)
+{
+	float elapsed = now - lastRecordTime;
+	if (elapsed < 0) {
+		elapsed = interval;
+	}
+	if (elapsed < interval) {
+		return;
+	}
+	// This cannot be event-based since goals may be disabled.
+	if (playingFromCheckpoint && (resetOnGoal || resetOnBallGround)) {
+		Vec3 ballLoc = world.ballLocation();
+		bool goal = resetOnGoal && goalCheckDue(world, now, ballLoc) && world.isInGoal(ballLoc);
+		if (goal || (resetOnBallGround && ballLoc.Z < world.ballRadius() + 5)) {
+			if (goal) {
+				scored(now, world.ballVelocity());
+			}
+			world.resetShot();
+			return;
+		}
+	}
+
+	lastRecordTime = now;
+	if (dodgeExpiration != 0) {
+		// If the timer expires or if the player double-jumps or gets a reset,
+		// clear the jump timer so we don't take the player's dodge.
+		if (now > dodgeExpiration ||
+			world.carDoubleJumped() ||
+			world.carWheelContacts() == 4) {
+			world.takeDodge();
+			dodgeExpiration = 0;
+		}
+	}
+
+	if (freezeBall) {
+		world.applyBall(latest.ball);
+	}
+
+	if (dodgeExpiration == 0) {
+		history.push_back(world.capture());
+	} else {
+		history.push_back(world.capture(MAX_DODGE_TIME - now + dodgeExpiration));
+	}
+	futureValid = false;
+	markers.detect(history, world.carWheelContacts(), touchedSinceRecord);
+	if (!playingFromCheckpoint && (attempting || attempts.recording())) {
+		finishAttempt(); // Freeplay was reset.
+	}
+	if (attempting) {
+		if (touchedSinceRecord && outcome.touchTime < 0) {
+			outcome.touchTime = now - attemptStart;
+		}
+		if (ballInGoal(history.back().ball.location)) {
+			scored(now, history.back().ball.velocity);
+		}
+	}
+	RewindInput input = world.input();
+	inputs.record(history, input);
+	attempts.record(history.back(), input);
+	touchedSinceRecord = false;
+	world.recorded(history.back(), now);
+}
+
+size_t Rewinder::currentIndex() const {
+	if (history.empty()) {
+		return 0;
+	}
+	return size_t(std::clamp<int64_t>(
+		int64_t(history.size()) + std::lround(rewindState.virtualTimeOffset / interval),
+		0, int64_t(history.size()) - 1));
+}
+
+void Rewinder::seek(size_t index) {
+	rewindState.virtualTimeOffset = -float(history.size() - index) * interval;
+	rewindState.holdingFor = 0;
+	rewindState.atCheckpoint = false;
+	rewindState.justLoadedQuickCheckpoint = false;
+	latest = history.at(index);
+}
+
+void Rewinder::finishAttempt() {
+	const Attempt* a = attempts.finish();
+	if (a != nullptr && events != nullptr) {
+		events->trace(EVENT_ATTEMPT, attempts.countFor(a->checkpoint), a->samples * a->interval);
+	}
+	if (!attempting) {
+		return;
+	}
+	attempting = false;
+	outcome.duration = std::max(lastRecordTime - attemptStart, 0.0f);
+	if (stats != nullptr && attemptCheckpoint != 0) {
+		statsFull |= !stats->record(attemptCheckpoint, outcome);
+	}
+}
+
+void Rewinder::scored(float now, Vec3 ballVelocity) {
+	if (attempting && outcome.goalTime < 0) {
+		outcome.goalTime = now - attemptStart;
+		outcome.goalSpeed = ballVelocity.magnitude();
+	}
+}
+
+void Rewinder::setCapacity(size_t entries) {
+	history.setCapacity(entries);
+	future.clear();
+	future.reserve(size_t(FUTURE_TIME / interval));
+	futureValid = false;
+}
+
+// Predicts a few more future states from the newest snapshot.  The car is
+// left where it was; only the ball moves.
+void Rewinder::extendFuture(World& world) {
+	if (history.empty()) {
+		return;
+	}
+	if (!futureValid) {
+		future.clear();
+		futureFlight = { history.back().ball.location, history.back().ball.velocity, world.ballRadius() };
+		futureValid = true;
+	}
+	size_t capacity = std::min(size_t(FUTURE_TIME / interval), future.capacity()); // See setCapacity().
+	float until = futureFlight.time + FUTURE_STEPS_PER_TICK * BALL_STEP;
+	while (future.size() < capacity) {
+		futureFlight.advanceTo((future.size() + 1) * interval);
+		future.push_back(history.back());
+		future.back().ball.location = futureFlight.location;
+		future.back().ball.velocity = futureFlight.velocity;
+		if (futureFlight.time >= until) {
+			break;
+		}
+	}
+}
+
+// Whether to ask World::isInGoal() on this snapshot.  Always near the goals
+// and the curved walls and corners, which predictBall does not model.
+// Elsewhere predicts the ball's flight when nothing is scheduled, then waits
+// until just before the predicted goal.  Checks that find nothing lead to a
+// new prediction.
+bool Rewinder::goalCheckDue(World& world, float now, Vec3 ballLoc) {
+	if (freezeBall) {
+		resetScheduled = false; // The ball is held in place.
+		return true;
+	}
+	if (ballNearGoalOrCurve(ballLoc, world.ballRadius())) {
+		resetScheduled = false; // Predict again on leaving the band.
+		return true;
+	}
+	if (!resetScheduled || now < resetPredictedAt) {
+		BallPrediction p = predictBall(ballLoc, world.ballVelocity(), world.ballRadius(), RESET_HORIZON, BALL_GOAL);
+		resetScheduled = true;
+		resetPredictedAt = now;
+		resetCheckTime = now + (p.event == BALL_NONE ? p.time : std::max(p.time - RESET_LEAD, 0.0f));
+	}
+	if (now < resetCheckTime) {
+		return false;
+	}
+	resetScheduled = false;
+	return true;
+}
+
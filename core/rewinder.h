@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "attempts.h"
+#include "ballistics.h"
+#include "eventlog.h"
+#include "history.h"
+#include "inputs.h"
+#include "markers.h"
+#include "state.h"
+#include "stats.h"
+
+#include <vector>
+
+struct RewindState {
+	bool atCheckpoint = false;
+	float virtualTimeOffset = 0; // Delta from end of buffer to "now"; positive in the predicted future
+	bool justDeletedCheckpoint = false;
+	bool justLoadedQuickCheckpoint = false;
+	float holdingFor = 0;
+	bool deleting = false;
+	int buttonsDown = 0x7f;
+};
+
+// The game as seen by Rewinder.  The plugin implements this over the
+// BakkesMod wrappers; bench/replay.cpp implements it over a recorded trace.
+class World {
+public:
+	virtual ~World() = default;
+
+	// Ball and car as captureGame() returns them; the second form overrides the
+	// car's jump timer.
+	virtual GameState capture() = 0;
+	virtual GameState capture(float lastJumped) = 0;
+	virtual Vec3 ballLocation() = 0;
+	virtual Vec3 ballVelocity() = 0;
+	virtual float ballRadius() = 0;
+	virtual bool isInGoal(Vec3 location) = 0;
+	virtual bool carDoubleJumped() = 0;
+	virtual int carWheelContacts() = 0;
+	// The player's controller input this tick.
+	virtual RewindInput input() = 0;
+	// Removes the car's jump and dodge.
+	virtual void takeDodge() = 0;
+	virtual void applyBall(const ActorState& s) = 0;
+	// Called after Rewinder changes rewindMode or freezeBall.
+	virtual void frozenChanged(bool car, bool ball) = 0;
+	// The ball scored or landed while playing from a checkpoint.
+	virtual void resetShot() = 0;
+	// Called with each snapshot added to history.
+	virtual void recorded(const GameState& s, float time) = 0;
+};
+
+// The per-tick record/rewind logic: records history while playing and scrubs
+// through it with the controller while frozen.  Must not allocate once
+// history is full.
+class Rewinder {
+public:
+	// Adds a snapshot to history if one is due.  now is the game event's
+	// GetSecondsElapsed().
+	void record(World& world, float now);
+	// Moves through history with the controller, or resumes play.  Returns
+	// true if latest should be applied to the game.
+	bool rewind(World& world, float now, const RewindInput& input);
+	// Resets rewind state to start from s; the caller applies and freezes it.
+	// checkpoint identifies the saved checkpoint s was loaded from (its
+	// GameState::hash(), before mirroring), or is 0.
+	void load(const GameState& s, uint64_t checkpoint = 0);
+	// A car touched the ball, so the predicted goal or landing is stale and
+	// the next snapshot is marked as a touch.
+	void ballTouched() { resetScheduled = false; touchedSinceRecord = true; }
+	// The ball went in during the current attempt.
+	void scored(float now, Vec3 ballVelocity);
+	// The snapshot in history nearest the rewind position.
+	size_t currentIndex() const;
+	// Moves the rewind position to history[index] and sets latest to it.
+	void seek(size_t index);
+	// Sizes history, and the future preview for the current interval, so
+	// neither allocates per tick.
+	void setCapacity(size_t entries);
+
+	HistoryBuffer<GameState> history;
+	MarkerIndex markers; // touches, jumps, landings and boost in history
+	InputHistory inputs; // what the player pressed for each snapshot
+	// Each attempt at a checkpoint, from resuming until the next load or
+	// reset.  Disabled until the plugin gives it a capacity.
+	AttemptRecorder attempts;
+	float attemptStart = 0; // when play resumed for the current attempt
+	// The current attempt's outcome, added to stats when it ends if play
+	// resumed at a saved checkpoint.
+	bool attempting = false;
+	AttemptOutcome outcome;
+	uint64_t loadedCheckpoint = 0; // see load()
+	uint64_t attemptCheckpoint = 0; // loadedCheckpoint if play resumed at it, else 0
+	StatsTable* stats = nullptr; // optional
+	bool statsFull = false; // an attempt did not fit in stats
+	bool touchedSinceRecord = false;
+	GameState latest;
+	RewindState rewindState;
+	bool rewindMode = false;
+	bool freezeBall = false;
+	float dodgeExpiration = 0;
+	bool hasQuickCheckpoint = false;
+	GameState quickCheckpoint;
+	float lastRecordTime = 0;
+	float lastRewindTime = 0;
+	bool playingFromCheckpoint = false;
+	// When resetting on goal, the ground is checked every snapshot but
+	// World::isInGoal() only near the goals and curved walls, or from shortly
+	// before the goal predicted after each touch.
+	bool resetScheduled = false;
+	float resetPredictedAt = 0;
+	float resetCheckTime = 0;
+	// Predicted states past the end of history, one per interval, for
+	// previewing the ball's flight.  Extended a little on each rewind() and
+	// rebuilt when history changes.
+	std::vector<GameState> future;
+	BallFlight futureFlight;
+	bool futureValid = false;
+	EventLog* events = nullptr; // optional
+
+	// Settings:
+	float interval = 0.010f; // time (s) between snapshots
+	bool deleteFutureHistory = false;
+	bool resetOnGoal = false;
+	bool resetOnBallGround = false;
+	bool previewFuture = false;
+
+private:
+	bool goalCheckDue(World& world, float now, Vec3 ballLoc);
+	void finishAttempt();
+	void extendFuture(World& world);
+};
+
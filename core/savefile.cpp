@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "savefile.h"
+
+#include <algorithm>
+
+bool readCheckpointFile(std::istream& in, std::vector<GameState>& checkpoints, std::vector<bool>& locks, uint32_t& version) {
+	checkpoints.clear();
+	locks.clear();
+	version = 0;
+	readPOD(in, version);
+	if (version != SAVE_FILE_VERSION) {
+		return false;
+	}
+	int32_t numSaves = 0;
+	readPOD(in, numSaves);
+	checkpoints.reserve(std::clamp(numSaves, 0, 1 << 20)); // Bounded in case the file is corrupt.
+	for (int32_t i = 0; i < numSaves; i++) {
+		checkpoints.emplace_back(in);
+	}
+	int32_t numLocks = 0; // older save files did not have this data; initialize to 0.
+	readPOD(in, numLocks);
+	for (int32_t i = 0; i < numLocks; i++) {
+		bool locked = false;
+		readPOD(in, locked);
+		locks.push_back(locked);
+	}
+	return true;
+}
+
+void writeCheckpointFile(std::ostream& out, const std::vector<GameState>& checkpoints, const std::vector<bool>& locks) {
+	auto ver = SAVE_FILE_VERSION;
+	writePOD(out, ver);
+	auto size = int32_t(checkpoints.size());
+	writePOD(out, size);
+	for (auto& fav : checkpoints) {
+		fav.write(out);
+	}
+	size = int32_t(locks.size());
+	writePOD(out, size);
+	for (bool l : locks) {
+		writePOD(out, l);
+	}
+}
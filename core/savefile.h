@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "state.h"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+// Prevent loading an unknown version's save file.
+constexpr uint32_t SAVE_FILE_VERSION = 1;
+
+// Reads checkpoints and their locks from a save file.  Returns false, leaving
+// both empty, if the file is not SAVE_FILE_VERSION; version receives the
+// file's version.
+bool readCheckpointFile(std::istream& in, std::vector<GameState>& checkpoints, std::vector<bool>& locks, uint32_t& version);
+void writeCheckpointFile(std::ostream& out, const std::vector<GameState>& checkpoints, const std::vector<bool>& locks);
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+void WeightedSampler::assign(const std::vector<double>& w) {
+	weights = w;
+	size_t n = weights.size();
+	tree.assign(n + 1, 0);
+	for (size_t i = 1; i <= n; i++) {
+		tree[i] += weights[i - 1];
+		size_t parent = i + (i & (0 - i));
+		if (parent <= n) {
+			tree[parent] += tree[i];
+		}
+	}
+	topBit = 1;
+	while (topBit * 2 <= n) {
+		topBit *= 2;
+	}
+}
+
+void WeightedSampler::set(size_t i, double weight) {
+	double delta = weight - weights[i];
+	weights[i] = weight;
+	for (size_t j = i + 1; j < tree.size(); j += j & (0 - j)) {
+		tree[j] += delta;
+	}
+}
+
+double WeightedSampler::total() const {
+	double sum = 0;
+	for (size_t j = weights.size(); j > 0; j -= j & (0 - j)) {
+		sum += tree[j];
+	}
+	return sum;
+}
+
+size_t WeightedSampler::pick(double u) const {
+	if (weights.empty()) {
+		return 0;
+	}
+	// Descends from the largest power of two, skipping each range whose sum
+	// is below what is left of the target.
+	double rest = u * total();
+	size_t pos = 0;
+	for (size_t step = topBit; step > 0; step /= 2) {
+		if (pos + step < tree.size() && tree[pos + step] <= rest) {
+			pos += step;
+			rest -= tree[pos];
+		}
+	}
+	return std::min(pos, weights.size() - 1);
+}
+
+double ShotScheduler::weightOf(size_t i, const StatsTable& stats) const {
+	double missRate = 0.5;
+	int32_t priority = 0;
+	const CheckpointStats* s = stats.find(keys[i]);
+	if (s != nullptr) {
+		// Counts one miss and one goal up front so a few attempts do not swing it.
+		missRate = (s->attempts - s->goals + 1.0) / (s->attempts + 2.0);
+		priority = std::clamp(s->priority, -SHOT_MAX_PRIORITY, SHOT_MAX_PRIORITY);
+	}
+	double w = (1 + SHOT_MISS_WEIGHT * missRate) * ldexp(1.0, priority);
+	return recentCount[i] > 0 ? w * SHOT_RECENT_WEIGHT : w;
+}
+
+void ShotScheduler::rebuild(const std::vector<GameState>& checkpoints, const StatsTable& stats) {
+	size_t n = checkpoints.size();
+	keys.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		keys[i] = checkpoints[i].hash();
+	}
+	recentCount.assign(n, 0);
+	recentCapacity = std::min(SHOT_RECENT_PICKS, n / 2);
+	recent.assign(recentCapacity, 0);
+	recentNext = 0;
+	recentSize = 0;
+	std::vector<double> weights(n);
+	for (size_t i = 0; i < n; i++) {
+		weights[i] = weightOf(i, stats);
+	}
+	sampler.assign(weights);
+	valid = true;
+}
+
+size_t ShotScheduler::next(const std::vector<GameState>& checkpoints, const StatsTable& stats, double u) {
+	if (!valid || keys.size() != checkpoints.size()) {
+		rebuild(checkpoints, stats);
+	}
+	size_t i = sampler.pick(u);
+	if (recentCapacity == 0) {
+		update(i, stats); // Picks up the last attempt's stats.
+		return i;
+	}
+	if (recentSize == recentCapacity) {
+		size_t oldest = recent[recentNext];
+		recentCount[oldest]--;
+		update(oldest, stats);
+	} else {
+		recentSize++;
+	}
+	recent[recentNext] = uint32_t(i);
+	recentNext = (recentNext + 1) % recentCapacity;
+	recentCount[i]++;
+	update(i, stats);
+	return i;
+}
+
+void ShotScheduler::update(size_t i, const StatsTable& stats) {
+	if (valid && i < keys.size()) {
+		sampler.set(i, weightOf(i, stats));
+	}
+}
+
+double ShotScheduler::chance(size_t i) const {
+	if (!valid || i >= keys.size()) {
+		return 0;
+	}
+	return sampler.weight(i) / sampler.total();
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "state.h"
+#include "stats.h"
+
+#include <cstdint>
+#include <vector>
+
+// Weights kept as prefix sums in a Fenwick tree, so changing one weight and
+// picking an index with probability proportional to its weight are both
+// O(log n).
+class WeightedSampler {
+public:
+	// Replaces every weight; O(n).
+	void assign(const std::vector<double>& weights);
+	void set(size_t i, double weight);
+	double weight(size_t i) const { return weights[i]; }
+	double total() const;
+	size_t size() const { return weights.size(); }
+	// The index whose share of the total holds u * total(), for u in [0, 1).
+	size_t pick(double u) const;
+
+private:
+	std::vector<double> tree; // tree[i] sums weights (i - (i & -i), i]; 1-based
+	std::vector<double> weights;
+	size_t topBit = 0; // highest power of two <= size()
+};
+
+constexpr double SHOT_MISS_WEIGHT = 3; // added to a shot's weight for missing every time
+constexpr double SHOT_RECENT_WEIGHT = 0.05; // weight kept by a shot played in the last few picks
+constexpr size_t SHOT_RECENT_PICKS = 16; // at most; half the shots if fewer
+constexpr int32_t SHOT_MAX_PRIORITY = 3; // 8x as likely; -3 is 1/8 as likely
+
+// Picks shots for cpt_weighted_loads.  A shot's weight grows with how
+// often it was missed (from its stats, assuming a miss rate of one half
+// until it has been tried), doubles with each step of priority, and is
+// mostly suppressed while the shot is among the last few picked.  Each
+// pick updates only the picked shot and the one leaving the recent picks.
+class ShotScheduler {
+public:
+	// Checkpoints were added, removed or reordered; rebuilt on the next pick.
+	void invalidate() { valid = false; }
+	// Returns the next checkpoint to play; u is uniform in [0, 1).
+	size_t next(const std::vector<GameState>& checkpoints, const StatsTable& stats, double u);
+	// Recomputes checkpoint i's weight after its stats or priority changed.
+	void update(size_t i, const StatsTable& stats);
+	// The chance (0-1) that checkpoint i is picked next.
+	double chance(size_t i) const;
+
+private:
+	void rebuild(const std::vector<GameState>& checkpoints, const StatsTable& stats);
+	double weightOf(size_t i, const StatsTable& stats) const;
+
+	bool valid = false;
+	WeightedSampler sampler;
+	std::vector<uint64_t> keys; // GameState::hash() of each checkpoint
+	std::vector<uint8_t> recentCount; // times each checkpoint is in recent
+	std::vector<uint32_t> recent; // ring of the last picks
+	size_t recentNext = 0; // slot in recent for the next pick
+	size_t recentSize = 0;
+	size_t recentCapacity = 0;
+};
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "similarity.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float ROTATION_UNIT_WEIGHT = SIMILAR_ROTATION_WEIGHT * 2 * PI_F / 65536;
+
+static float square(float x) {
+	return x * x;
+}
+
+// d[i] = the weighted squared distance from target to snapshot i, from
+// features f (ball then car location, then ball then car velocity, XYZ each)
+// and car rotations r (pitch, yaw, roll).  A single pass over all features
+// that the compiler can vectorize, given the pointers do not alias.
+static void distancesTo(size_t n, const float* const* f, const int32_t* const* r,
+	const float* t, const int32_t* tr, float* __restrict d) {
+	const float* __restrict bx = f[0], * __restrict by = f[1], * __restrict bz = f[2];
+	const float* __restrict cx = f[3], * __restrict cy = f[4], * __restrict cz = f[5];
+	const float* __restrict bvx = f[6], * __restrict bvy = f[7], * __restrict bvz = f[8];
+	const float* __restrict cvx = f[9], * __restrict cvy = f[10], * __restrict cvz = f[11];
+	const int32_t* __restrict pitch = r[0], * __restrict yaw = r[1], * __restrict roll = r[2];
+	constexpr float vw = SIMILAR_VELOCITY_WEIGHT * SIMILAR_VELOCITY_WEIGHT;
+	constexpr float rw = ROTATION_UNIT_WEIGHT * ROTATION_UNIT_WEIGHT;
+	for (size_t i = 0; i < n; i++) {
+		float location = square(bx[i] - t[0]) + square(by[i] - t[1]) + square(bz[i] - t[2]) +
+			square(cx[i] - t[3]) + square(cy[i] - t[4]) + square(cz[i] - t[5]);
+		float velocity = square(bvx[i] - t[6]) + square(bvy[i] - t[7]) + square(bvz[i] - t[8]) +
+			square(cvx[i] - t[9]) + square(cvy[i] - t[10]) + square(cvz[i] - t[11]);
+		// The short way around, by wrapping the difference to 16 bits.
+		float rotation = square(float(int16_t(pitch[i] - tr[0]))) +
+			square(float(int16_t(yaw[i] - tr[1]))) + square(float(int16_t(roll[i] - tr[2])));
+		d[i] = location + vw * velocity + rw * rotation;
+	}
+}
+
+void HistorySearch::gather(const HistoryBuffer<GameState>& history) {
+	if (gathered == &history && gatheredVersion == history.version()) {
+		return;
+	}
+	size_t n = history.size();
+	for (auto& f : floats) {
+		f.resize(n);
+	}
+	for (auto& r : rotations) {
+		r.resize(n);
+	}
+	history.forEach([this](size_t i, const GameState& s) {
+		const Vec3 v[4] = { s.ball.location, s.car.actorState.location, s.ball.velocity, s.car.actorState.velocity };
+		for (int j = 0; j < 4; j++) {
+			floats[j * 3][i] = v[j].X;
+			floats[j * 3 + 1][i] = v[j].Y;
+			floats[j * 3 + 2][i] = v[j].Z;
+		}
+		rotations[0][i] = s.car.actorState.rotation.Pitch;
+		rotations[1][i] = s.car.actorState.rotation.Yaw;
+		rotations[2][i] = s.car.actorState.rotation.Roll;
+	});
+	gathered = &history;
+	gatheredVersion = history.version();
+}
+
+// Rules out distances [begin, end) and refreshes the minimums of their blocks.
+void HistorySearch::suppress(size_t begin, size_t end) {
+	std::fill(distances.begin() + begin, distances.begin() + end, INFINITY);
+	for (size_t b = begin / BLOCK; b * BLOCK < end; b++) {
+		size_t blockEnd = std::min(distances.size(), (b + 1) * BLOCK);
+		blockMin[b] = *std::min_element(distances.begin() + b * BLOCK, distances.begin() + blockEnd);
+	}
+}
+
+void HistorySearch::search(const HistoryBuffer<GameState>& history, const GameState& target,
+	size_t k, size_t separation, size_t exclude, std::vector<HistoryMatch>& matches) {
+	matches.clear();
+	gather(history);
+	size_t n = history.size();
+	distances.resize(n);
+	const float* f[FLOATS];
+	for (int j = 0; j < FLOATS; j++) {
+		f[j] = floats[j].data();
+	}
+	const int32_t* r[ROTATIONS];
+	for (int j = 0; j < ROTATIONS; j++) {
+		r[j] = rotations[j].data();
+	}
+	const Vec3 v[4] = { target.ball.location, target.car.actorState.location, target.ball.velocity, target.car.actorState.velocity };
+	float t[FLOATS];
+	for (int j = 0; j < 4; j++) {
+		t[j * 3] = v[j].X;
+		t[j * 3 + 1] = v[j].Y;
+		t[j * 3 + 2] = v[j].Z;
+	}
+	const IRot& rot = target.car.actorState.rotation;
+	const int32_t tr[ROTATIONS] = { rot.Pitch, rot.Yaw, rot.Roll };
+	distancesTo(n, f, r, t, tr, distances.data());
+
+	// Takes the closest remaining snapshot k times, ruling out its neighbors
+	// each time.  Only the block holding the closest is searched, and only
+	// the blocks touched by ruling out are searched again.
+	size_t blocks = (n + BLOCK - 1) / BLOCK;
+	blockMin.resize(blocks);
+	for (size_t b = 0; b < blocks; b++) {
+		const float* d = distances.data() + b * BLOCK;
+		size_t m = std::min(BLOCK, n - b * BLOCK);
+		float least = INFINITY;
+		for (size_t i = 0; i < m; i++) {
+			least = std::min(least, d[i]);
+		}
+		blockMin[b] = least;
+	}
+	auto window = [&](size_t center, size_t& begin, size_t& end) {
+		begin = center > separation ? center - separation : 0;
+		end = std::min(n, center + separation + 1);
+	};
+	size_t begin, end;
+	if (exclude < n) {
+		window(exclude, begin, end);
+		suppress(begin, end);
+	}
+	while (matches.size() < k) {
+		auto block = std::min_element(blockMin.begin(), blockMin.end());
+		if (block == blockMin.end() || *block == INFINITY) {
+			break;
+		}
+		size_t b = size_t(block - blockMin.begin());
+		auto blockBegin = distances.begin() + b * BLOCK;
+		auto best = std::find(blockBegin, blockBegin + std::min(BLOCK, n - b * BLOCK), *block);
+		size_t index = size_t(best - distances.begin());
+		matches.push_back({ index, sqrtf(*best) });
+		window(index, begin, end);
+		suppress(begin, end);
+	}
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "history.h"
+#include "state.h"
+
+#include <vector>
+
+// Finds the moments in history most like a given state, so rewinding can
+// jump straight to them.  The distance combines ball and car location,
+// velocity scaled by SIMILAR_VELOCITY_WEIGHT seconds, and the car's rotation
+// at SIMILAR_ROTATION_WEIGHT uu per radian.
+
+constexpr float SIMILAR_VELOCITY_WEIGHT = 0.25f; // s
+constexpr float SIMILAR_ROTATION_WEIGHT = 300; // uu per radian
+
+struct HistoryMatch {
+	size_t index; // into history
+	float distance;
+};
+
+// Keeps history in structure-of-arrays layout between searches, so the
+// distance scan vectorizes and searching does not allocate once the buffers
+// have grown to the history's size.  The layout is only rebuilt when history
+// has changed, so repeated searches while rewinding just scan.
+class HistorySearch {
+public:
+	// Sets matches to the k snapshots closest to target, closest first.
+	// Matches are more than separation snapshots apart, so one moment does
+	// not fill the list, and none are within separation of exclude (the
+	// target's own place in history, or SIZE_MAX).
+	void search(const HistoryBuffer<GameState>& history, const GameState& target,
+		size_t k, size_t separation, size_t exclude, std::vector<HistoryMatch>& matches);
+
+private:
+	static constexpr int FLOATS = 12; // ball and car location and velocity
+	static constexpr int ROTATIONS = 3; // car pitch, yaw and roll
+	static constexpr size_t BLOCK = 64; // snapshots per block when picking the closest
+
+	void gather(const HistoryBuffer<GameState>& history);
+	void suppress(size_t begin, size_t end);
+
+	std::vector<float> floats[FLOATS];
+	std::vector<int32_t> rotations[ROTATIONS];
+	const HistoryBuffer<GameState>* gathered = nullptr;
+	uint64_t gatheredVersion = 0;
+
+	std::vector<float> distances;
+	std::vector<float> blockMin; // min of each BLOCK of distances
+};
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "spatial.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+constexpr float CELL_SIZE = 512;
+// The arena, goals included, in cells; locations outside go in the edge cells.
+constexpr float GRID_MIN_X = -4096, GRID_MIN_Y = -6144, GRID_MIN_Z = 0;
+constexpr int GRID_X = 16, GRID_Y = 24, GRID_Z = 4;
+
+CheckpointIndex::CheckpointIndex() : cells(GRID_X * GRID_Y * GRID_Z) {}
+
+void CheckpointIndex::featuresOf(const GameState& s, float* f) {
+	const Vec3 v[4] = {
+		s.ball.location,
+		s.car.actorState.location,
+		s.ball.velocity * NEAREST_VELOCITY_WEIGHT,
+		s.car.actorState.velocity * NEAREST_VELOCITY_WEIGHT,
+	};
+	for (int i = 0; i < 4; i++) {
+		f[i * 3] = v[i].X;
+		f[i * 3 + 1] = v[i].Y;
+		f[i * 3 + 2] = v[i].Z;
+	}
+}
+
+int CheckpointIndex::cellOf(Vec3 location, int& x, int& y, int& z) {
+	x = std::clamp(int(floorf((location.X - GRID_MIN_X) / CELL_SIZE)), 0, GRID_X - 1);
+	y = std::clamp(int(floorf((location.Y - GRID_MIN_Y) / CELL_SIZE)), 0, GRID_Y - 1);
+	z = std::clamp(int(floorf((location.Z - GRID_MIN_Z) / CELL_SIZE)), 0, GRID_Z - 1);
+	return (x * GRID_Y + y) * GRID_Z + z;
+}
+
+void CheckpointIndex::build(const std::vector<GameState>& checkpoints) {
+	clear();
+	for (size_t i = 0; i < checkpoints.size(); i++) {
+		add(i, checkpoints[i]);
+	}
+}
+
+void CheckpointIndex::add(size_t index, const GameState& s) {
+	int x, y, z;
+	Entry e;
+	e.index = index;
+	featuresOf(s, e.features);
+	cells[cellOf(s.ball.location, x, y, z)].push_back(e);
+	count++;
+}
+
+void CheckpointIndex::remove(size_t index) {
+	for (auto& cell : cells) {
+		for (size_t i = 0; i < cell.size(); ) {
+			if (cell[i].index == index) {
+				cell[i] = cell.back();
+				cell.pop_back();
+				count--;
+				continue;
+			}
+			if (cell[i].index > index) {
+				cell[i].index--;
+			}
+			i++;
+		}
+	}
+}
+
+void CheckpointIndex::clear() {
+	for (auto& cell : cells) {
+		cell.clear();
+	}
+	count = 0;
+}
+
+bool CheckpointIndex::nearest(const GameState& s, size_t& index) const {
+	if (count == 0) {
+		return false;
+	}
+	float f[FEATURES];
+	featuresOf(s, f);
+	int qx, qy, qz;
+	cellOf(s.ball.location, qx, qy, qz);
+	float best = INFINITY; // squared distance
+	auto scan = [&](int x, int y, int z) {
+		for (auto& e : cells[(x * GRID_Y + y) * GRID_Z + z]) {
+			float d = 0;
+			for (int i = 0; i < FEATURES; i++) {
+				float diff = e.features[i] - f[i];
+				d += diff * diff;
+			}
+			if (d < best) {
+				best = d;
+				index = e.index;
+			}
+		}
+	};
+	int maxRing = std::max({ GRID_X, GRID_Y, GRID_Z });
+	for (int r = 0; r < maxRing; r++) {
+		// The cells at Chebyshev distance r from the query's cell.
+		for (int x = std::max(qx - r, 0); x <= std::min(qx + r, GRID_X - 1); x++) {
+			for (int y = std::max(qy - r, 0); y <= std::min(qy + r, GRID_Y - 1); y++) {
+				if (std::abs(x - qx) == r || std::abs(y - qy) == r) {
+					for (int z = std::max(qz - r, 0); z <= std::min(qz + r, GRID_Z - 1); z++) {
+						scan(x, y, z);
+					}
+					continue;
+				}
+				if (qz - r >= 0) {
+					scan(x, y, qz - r);
+				}
+				if (r > 0 && qz + r < GRID_Z) {
+					scan(x, y, qz + r);
+				}
+			}
+		}
+		// Checkpoints in further rings are at least r cells away by ball
+		// location alone.
+		float bound = r * CELL_SIZE;
+		if (best <= bound * bound) {
+			break;
+		}
+	}
+	return true;
+}
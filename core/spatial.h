@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "state.h"
+
+#include <vector>
+
+// Finds the checkpoint most like a game state: nearest by ball and car
+// location, plus velocity scaled by NEAREST_VELOCITY_WEIGHT seconds.
+// Checkpoints live in a uniform grid of cells by ball location; a query
+// searches rings of cells outward from the query's cell until no closer
+// checkpoint can be left.
+
+constexpr float NEAREST_VELOCITY_WEIGHT = 0.25f; // s; 1000 uu/s apart counts as 250 uu
+
+class CheckpointIndex {
+public:
+	CheckpointIndex();
+
+	// Indexes checkpoints [0, n).
+	void build(const std::vector<GameState>& checkpoints);
+	// Indexes a checkpoint added at the end, at index.
+	void add(size_t index, const GameState& s);
+	// Drops the checkpoint at index; later checkpoints move down by one.
+	void remove(size_t index);
+	void clear();
+	size_t size() const { return count; }
+
+	// Sets index to the nearest checkpoint to s.  Returns false if empty.
+	bool nearest(const GameState& s, size_t& index) const;
+
+private:
+	static constexpr int FEATURES = 12;
+	struct Entry {
+		size_t index;
+		float features[FEATURES];
+	};
+
+	static void featuresOf(const GameState& s, float* f);
+	static int cellOf(Vec3 location, int& x, int& y, int& z);
+
+	std::vector<std::vector<Entry>> cells;
+	size_t count = 0;
+};
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "state.h"
+
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+static inline void readVec(std::istream& in, Vec3& v) {
+	readPOD(in, v.X);
+	readPOD(in, v.Y);
+	readPOD(in, v.Z);
+}
+static inline void writeVec(std::ostream& out, const Vec3& v) {
+	writePOD(out, v.X);
+	writePOD(out, v.Y);
+	writePOD(out, v.Z);
+}
+static inline void readRot(std::istream& in, IRot& r) {
+	readPOD(in, r.Pitch);
+	readPOD(in, r.Yaw);
+	readPOD(in, r.Roll);
+}
+static inline void writeRot(std::ostream& out, const IRot& r) {
+	writePOD(out, r.Pitch);
+	writePOD(out, r.Yaw);
+	writePOD(out, r.Roll);
+}
+
+// Returns the angle <percent (0-1.0)> way between lh and rh, going the short
+// way around.
+static inline int lerpAngle(int lh, int rh, float percent) {
+	int diff = wrapURot(lh - rh);
+	return wrapURot(rh + int(diff * percent));
+}
+
+ActorState::ActorState() {
+	location = Vec3();
+	velocity = Vec3();
+	rotation = IRot();
+	angVelocity = Vec3();
+}
+// Returns the object state <percent (0-1.0)> way between lh and rh.
+ActorState::ActorState(const ActorState& lh, const ActorState& rh, float percent) {
+	float rhPercent = 1 - percent;
+	location = lh.location * percent + rh.location * rhPercent;
+	velocity = lh.velocity * percent + rh.velocity * rhPercent;
+
+	// TODO: Interpolating each axis separately goes slightly sideways when
+	// crossing vertical.  Figure out a better way to interpolate.
+	rotation.Pitch = lerpAngle(lh.rotation.Pitch, rh.rotation.Pitch, percent);
+	rotation.Yaw = lerpAngle(lh.rotation.Yaw, rh.rotation.Yaw, percent);
+	rotation.Roll = lerpAngle(lh.rotation.Roll, rh.rotation.Roll, percent);
+
+	angVelocity = lh.angVelocity * percent + rh.angVelocity * rhPercent;
+}
+ActorState::ActorState(std::istream& in) {
+	readVec(in, location);
+	readVec(in, velocity);
+	readRot(in, rotation);
+	readVec(in, angVelocity);
+}
+void ActorState::write(std::ostream& out) const {
+	writeVec(out, location);
+	writeVec(out, velocity);
+	writeRot(out, rotation);
+	writeVec(out, angVelocity);
+}
+
+// Mirrors across the plane X = 0.  The car is symmetric, so its mirror image
+// faces the mirrored direction with the opposite roll.
+ActorState ActorState::mirror() const {
+	ActorState as = *this;
+	as.location.X *= -1;
+	as.velocity.X *= -1;
+	as.angVelocity.Y *= -1;
+	as.angVelocity.Z *= -1;
+	as.rotation.Yaw = wrapURot(32768 - rotation.Yaw);
+	as.rotation.Roll = wrapURot(-rotation.Roll);
+	return as;
+}
+
+CarState::CarState() {
+	actorState = ActorState();
+	boostAmount = 0;
+	hasDodge = false;
+	lastJumped = 0;
+	boosting = 0;
+}
+// Returns the object state <percent (0-1.0)> way between lh and rh.
+CarState::CarState(const CarState& lh, const CarState& rh, float percent) {
+	actorState = ActorState(lh.actorState, rh.actorState, percent);
+	float rhPercent = 1 - percent;
+	boostAmount = lh.boostAmount * percent + rh.boostAmount * rhPercent;
+	if (lh.lastJumped == -1 || rh.lastJumped == -1) {
+		lastJumped = -1;
+		hasDodge = true;
+	} else if (rh.lastJumped < lh.lastJumped) {
+		lastJumped = 0;
+		hasDodge = true;
+	} else { // lh.lastJumped <= rh.lastJumped
+		lastJumped = lh.lastJumped * percent + rh.lastJumped * rhPercent;
+		hasDodge = lastJumped < MAX_DODGE_TIME;
+	}
+	boosting = lh.boosting;
+}
+
+CarState::CarState(std::istream& in) {
+	actorState = ActorState(in);
+	readPOD(in, boostAmount);
+	readPOD(in, hasDodge);
+	readPOD(in, lastJumped);
+	boosting = 0;
+}
+
+void CarState::write(std::ostream& out) const {
+	actorState.write(out);
+	writePOD(out, boostAmount);
+	writePOD(out, hasDodge);
+	writePOD(out, lastJumped);
+}
+
+CarState CarState::mirror() const {
+	CarState cs = *this;
+	cs.actorState = cs.actorState.mirror();
+	return cs;
+}
+
+GameState::GameState() {
+	ball = ActorState();
+	car = CarState();
+	time = -1;
+}
+
+GameState::GameState(std::istream& in) {
+	readVec(in, ball.location);
+	readVec(in, car.actorState.location);
+	readVec(in, ball.velocity);
+	readVec(in, car.actorState.velocity);
+	readRot(in, ball.rotation);
+	readRot(in, car.actorState.rotation);
+	readVec(in, ball.angVelocity);
+	readVec(in, car.actorState.angVelocity);
+	readPOD(in, car.boostAmount);
+	readPOD(in, car.hasDodge);
+	readPOD(in, car.lastJumped);
+	time = -1;
+}
+
+void GameState::write(std::ostream& out) const {
+	writeVec(out, ball.location);
+	writeVec(out, car.actorState.location);
+	writeVec(out, ball.velocity);
+	writeVec(out, car.actorState.velocity);
+	writeRot(out, ball.rotation);
+	writeRot(out, car.actorState.rotation);
+	writeVec(out, ball.angVelocity);
+	writeVec(out, car.actorState.angVelocity);
+	writePOD(out, car.boostAmount);
+	writePOD(out, car.hasDodge);
+	writePOD(out, car.lastJumped);
+}
+
+template<typename T>
+static inline void fnv1a(uint64_t& h, const T& t) {
+	auto p = reinterpret_cast<const unsigned char*>(&t);
+	for (size_t i = 0; i < sizeof(T); i++) {
+		h = (h ^ p[i]) * 0x100000001b3ull;
+	}
+}
+static inline void hashVec(uint64_t& h, const Vec3& v) {
+	fnv1a(h, v.X);
+	fnv1a(h, v.Y);
+	fnv1a(h, v.Z);
+}
+static inline void hashRot(uint64_t& h, const IRot& r) {
+	fnv1a(h, r.Pitch);
+	fnv1a(h, r.Yaw);
+	fnv1a(h, r.Roll);
+}
+
+// Same fields and order as write().
+uint64_t GameState::hash() const {
+	uint64_t h = 0xcbf29ce484222325ull;
+	hashVec(h, ball.location);
+	hashVec(h, car.actorState.location);
+	hashVec(h, ball.velocity);
+	hashVec(h, car.actorState.velocity);
+	hashRot(h, ball.rotation);
+	hashRot(h, car.actorState.rotation);
+	hashVec(h, ball.angVelocity);
+	hashVec(h, car.actorState.angVelocity);
+	fnv1a(h, car.boostAmount);
+	fnv1a(h, car.hasDodge);
+	fnv1a(h, car.lastJumped);
+	return h;
+}
+
+// Returns the game state <percent (0-1.0)> way between lh and rh.
+
+GameState::GameState(const GameState &lh, const GameState &rh, float percent) {
+	ball = ActorState(lh.ball, rh.ball, percent);
+	car = CarState(lh.car, rh.car, percent);
+	if (lh.time != -1 && rh.time != -1) {
+		time = (lh.time + rh.time) / 2;
+	} else {
+		time = -1;
+	}
+}
+
+GameState GameState::mirror() const {
+	GameState gs;
+	gs.car = car.mirror();
+	gs.ball = ball.mirror();
+	return gs;
+}
+
+/*
+ * base64enc and base64dec from https://stackoverflow.com/a/34571089.  No license
+ * information provided.
+ */
+
+const std::string_view b64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string base64enc(const std::string in) {
+	std::string out;
+
+	unsigned val = 0;
+	int valb = -6;
+	for (unsigned char c : in) {
+		val = (val << 8) + c;
+		valb += 8;
+		while (valb >= 0) {
+			out.push_back(b64[(val >> valb) & 0x3F]);
+			valb -= 6;
+		}
+	}
+	if (valb > -6) out.push_back(b64[((val << 8) >> (valb + 8)) & 0x3F]);
+	while (out.size() % 4) out.push_back('=');
+	return out;
+}
+
+const std::string base64dec(const std::string in) {
+	std::string out;
+
+	std::vector<int> T(256, -1);
+	for (int i = 0; i < 64; i++) T[b64[i]] = i;
+
+	unsigned val = 0;
+	int valb = -8;
+	for (unsigned char c : in) {
+		if (T[c] == -1) break;
+		val = (val << 6) + T[c];
+		valb += 6;
+		if (valb >= 0) {
+			out.push_back(char((val >> valb) & 0xFF));
+			valb -= 8;
+		}
+	}
+	return out;
+}
+
+GameState::GameState(const std::string enc) {
+	std::string dec = base64dec(enc);
+	std::istringstream stream(dec);
+	readVec(stream, ball.location);
+	readVec(stream, car.actorState.location);
+	readVec(stream, ball.velocity);
+	readVec(stream, car.actorState.velocity);
+	readRot(stream, ball.rotation);
+	readRot(stream, car.actorState.rotation);
+	readVec(stream, ball.angVelocity);
+	readVec(stream, car.actorState.angVelocity);
+	readPOD(stream, car.boostAmount);
+	readPOD(stream, car.hasDodge);
+	readPOD(stream, car.lastJumped);
+	time = -1;
+}
+
+const std::string GameState::toString() const {
+	std::ostringstream dec;
+	write(dec);
+	return base64enc(dec.str());
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "vec.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+constexpr float MAX_DODGE_TIME = 1.2f;
+
+template<typename T>
+void writePOD(std::ostream& out, const T& t) {
+	out.write(reinterpret_cast<const char*>(&t), sizeof(T));
+}
+
+template<typename T>
+void readPOD(std::istream& in, T& t) {
+	T temp;
+	in.read(reinterpret_cast<char*>(&temp), sizeof(T));
+	if (in.eof()) {
+		return;
+	}
+	t = temp;
+}
+
+// State of the game, independent of the BakkesMod SDK.  The plugin captures
+// and applies these through the wrappers in state.h.
+
+class ActorState {
+public:
+	Vec3 location;
+	Vec3 velocity;
+	IRot rotation;
+	Vec3 angVelocity;
+
+	ActorState();
+	ActorState(const ActorState& lh, const ActorState& rh, float percent);
+	ActorState(std::istream& in);
+
+	void write(std::ostream& out) const;
+	ActorState mirror() const;
+};
+
+class CarState {
+public:
+	ActorState actorState;
+	float boostAmount;
+	bool hasDodge;
+	float lastJumped; // cannot apply; used to reset dodge in record().
+	long boosting;
+
+	CarState();
+	CarState(const CarState& lh, const CarState& rh, float percent);
+	CarState(std::istream& in);
+
+	void write(std::ostream& out) const;
+	CarState mirror() const;
+};
+
+class GameState {
+public:
+	ActorState ball;
+	CarState car;
+	float time; // -1 if not in a timed mode
+
+	GameState();
+	GameState(const GameState& lh, const GameState& rh, float percent);
+	GameState(std::istream& in);
+	GameState(std::string str);
+
+	void write(std::ostream& out) const;
+	const std::string toString() const;
+	GameState mirror() const;
+	// FNV-1a of the fields write() saves; identifies a checkpoint's content.
+	uint64_t hash() const;
+};
+
+std::string base64enc(const std::string in);
+const std::string base64dec(const std::string in);
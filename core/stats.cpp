@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<CheckpointStats>, "CheckpointStats is stored in the stats file as raw bytes");
+
+constexpr uint32_t STATS_FILE_MAGIC = 0x54535043; // "CPST"
+constexpr uint32_t MAX_LOAD_PERCENT = 75; // beyond this, probes get long
+constexpr uint32_t MIN_SLOTS = 4096;
+constexpr uint32_t MAX_SLOTS = 1u << 30;
+
+// 0 marks an empty slot, so a checkpoint hashing to 0 is stored as 1.
+static uint64_t slotKey(uint64_t checkpoint) {
+	return checkpoint == 0 ? 1 : checkpoint;
+}
+
+size_t StatsTable::bytesFor(uint32_t slots) {
+	return sizeof(Header) + size_t(slots) * sizeof(CheckpointStats);
+}
+
+uint32_t StatsTable::slotsFor(size_t n) {
+	uint32_t slots = MIN_SLOTS;
+	while (uint64_t(slots) * MAX_LOAD_PERCENT < uint64_t(n) * 150 && slots < MAX_SLOTS) {
+		slots *= 2;
+	}
+	return slots;
+}
+
+void StatsTable::attach(char* memory, size_t bytes) {
+	detach();
+	if (bytes < sizeof(Header)) {
+		return;
+	}
+	Header* h = reinterpret_cast<Header*>(memory);
+	if (h->magic != STATS_FILE_MAGIC || h->version != STATS_FILE_VERSION ||
+		h->recordSize != sizeof(CheckpointStats) || h->slots == 0 || (h->slots & (h->slots - 1)) != 0 ||
+		h->slots > MAX_SLOTS || bytesFor(h->slots) > bytes) {
+		format(memory, bytes);
+		return;
+	}
+	header = h;
+	slots = reinterpret_cast<CheckpointStats*>(memory + sizeof(Header));
+}
+
+void StatsTable::format(char* memory, size_t bytes) {
+	detach();
+	uint32_t n = 1;
+	while (bytesFor(n * 2) <= bytes && n < MAX_SLOTS) {
+		n *= 2;
+	}
+	if (bytesFor(n) > bytes) {
+		return;
+	}
+	memset(memory, 0, bytesFor(n));
+	Header* h = reinterpret_cast<Header*>(memory);
+	*h = { STATS_FILE_MAGIC, STATS_FILE_VERSION, sizeof(CheckpointStats), n, 0, 0 };
+	header = h;
+	slots = reinterpret_cast<CheckpointStats*>(memory + sizeof(Header));
+}
+
+bool StatsTable::copyFrom(const StatsTable& from, const std::vector<uint64_t>& checkpoints) {
+	bool copied = true;
+	for (uint64_t checkpoint : checkpoints) {
+		const CheckpointStats* s = from.find(checkpoint);
+		if (s == nullptr) {
+			continue;
+		}
+		CheckpointStats* to = insert(checkpoint);
+		if (to == nullptr) {
+			copied = false;
+			continue;
+		}
+		*to = *s;
+	}
+	return copied;
+}
+
+void StatsTable::detach() {
+	header = nullptr;
+	slots = nullptr;
+}
+
+uint32_t StatsTable::size() const {
+	return header != nullptr ? header->used : 0;
+}
+
+uint32_t StatsTable::capacity() const {
+	return header != nullptr ? header->slots : 0;
+}
+
+CheckpointStats* StatsTable::probe(uint64_t checkpoint) const {
+	if (header == nullptr) {
+		return nullptr;
+	}
+	uint64_t key = slotKey(checkpoint);
+	uint32_t mask = header->slots - 1;
+	uint32_t i = uint32_t(key ^ (key >> 32)) & mask;
+	for (uint32_t n = 0; n < header->slots; n++, i = (i + 1) & mask) {
+		if (slots[i].checkpoint == key || slots[i].checkpoint == 0) {
+			return &slots[i];
+		}
+	}
+	return nullptr;
+}
+
+const CheckpointStats* StatsTable::find(uint64_t checkpoint) const {
+	CheckpointStats* s = probe(checkpoint);
+	return s != nullptr && s->checkpoint != 0 ? s : nullptr;
+}
+
+CheckpointStats* StatsTable::insert(uint64_t checkpoint) {
+	CheckpointStats* s = probe(checkpoint);
+	if (s == nullptr) {
+		return nullptr;
+	}
+	if (s->checkpoint == 0) {
+		if (uint64_t(header->used + 1) * 100 > uint64_t(header->slots) * MAX_LOAD_PERCENT) {
+			return nullptr;
+		}
+		header->used++;
+		s->checkpoint = slotKey(checkpoint);
+	}
+	return s;
+}
+
+bool StatsTable::setPriority(uint64_t checkpoint, int32_t priority) {
+	CheckpointStats* s = insert(checkpoint);
+	if (s == nullptr) {
+		return false;
+	}
+	s->priority = priority;
+	return true;
+}
+
+bool StatsTable::record(uint64_t checkpoint, const AttemptOutcome& outcome) {
+	CheckpointStats* s = insert(checkpoint);
+	if (s == nullptr) {
+		return false;
+	}
+	s->attempts++;
+	if (outcome.touchTime >= 0) {
+		s->bestTouchTime = s->touches == 0 ? outcome.touchTime : std::min(s->bestTouchTime, outcome.touchTime);
+		s->touches++;
+		s->touchTimeTotal += outcome.touchTime;
+	}
+	if (outcome.goalTime >= 0) {
+		s->bestGoalTime = s->goals == 0 ? outcome.goalTime : std::min(s->bestGoalTime, outcome.goalTime);
+		s->goals++;
+		s->goalSpeedTotal += outcome.goalSpeed;
+		s->bestGoalSpeed = std::max(s->bestGoalSpeed, outcome.goalSpeed);
+	}
+	return true;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How an attempt at a checkpoint went, from resuming until the next load or
+// reset.
+struct AttemptOutcome {
+	float duration = 0; // s
+	float touchTime = -1; // s from resuming to the first touch; -1 if none
+	float goalTime = -1; // s from resuming to the ball going in; -1 if it did not
+	float goalSpeed = 0; // of the ball as it went in (uu/s)
+};
+
+struct CheckpointStats {
+	uint64_t checkpoint; // GameState::hash() of the saved checkpoint; 0 if the slot is empty
+	uint32_t attempts;
+	uint32_t goals;
+	uint32_t touches; // attempts with a touch
+	float touchTimeTotal; // s, over attempts with a touch
+	float bestTouchTime; // s; 0 until touches > 0
+	float bestGoalTime; // s; 0 until goals > 0
+	float goalSpeedTotal; // uu/s, over goals
+	float bestGoalSpeed; // uu/s
+	int32_t priority; // set by cpt_shot_priority; 0 is normal
+};
+
+constexpr uint32_t STATS_FILE_VERSION = 2;
+
+// Per-checkpoint outcome counters in a fixed block of memory (the plugin maps
+// a file), updated in place.  Checkpoints are found by content hash in an
+// open-addressed table, so reordering or deleting checkpoints leaves the
+// other entries alone.  A table does not grow by itself: the owner sizes it
+// with slotsFor() and rebuilds it with copyFrom(), which also drops the
+// entries of deleted checkpoints.  Once most slots are used, new checkpoints
+// are not counted.
+class StatsTable {
+public:
+	// Bytes needed for a table of slots entries (a power of two).
+	static size_t bytesFor(uint32_t slots);
+	// Slots for a library of n checkpoints, with room for half as many again.
+	static uint32_t slotsFor(size_t n);
+
+	// Uses memory as the table, clearing it unless it already holds one of
+	// this version that fits.  memory must stay valid until detach().
+	void attach(char* memory, size_t bytes);
+	// Like attach(), but always starts an empty table of as many slots as fit.
+	void format(char* memory, size_t bytes);
+	// Copies the entries of checkpoints (GameState::hash() values) from
+	// another table; the rest are left out.  Returns false if some did not fit.
+	bool copyFrom(const StatsTable& from, const std::vector<uint64_t>& checkpoints);
+	void detach();
+	bool attached() const { return header != nullptr; }
+
+	// nullptr if checkpoint has no stats.
+	const CheckpointStats* find(uint64_t checkpoint) const;
+	// Counts an attempt at checkpoint.  Returns false if the table is full.
+	bool record(uint64_t checkpoint, const AttemptOutcome& outcome);
+	bool setPriority(uint64_t checkpoint, int32_t priority);
+	uint32_t size() const;
+	uint32_t capacity() const;
+
+private:
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t recordSize;
+		uint32_t slots;
+		uint32_t used;
+		uint32_t reserved;
+	};
+
+	// The slot holding checkpoint, or the empty slot where it would go;
+	// nullptr if neither turns up.
+	CheckpointStats* probe(uint64_t checkpoint) const;
+	// Like probe(), but claims an empty slot; nullptr if the table is full.
+	CheckpointStats* insert(uint64_t checkpoint);
+
+	Header* header = nullptr;
+	CheckpointStats* slots = nullptr;
+};
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+
+static const char TRACE_MAGIC[4] = { 'C', 'P', 'T', 'R' };
+
+void writeTraceHeader(std::ostream& out) {
+	out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	writePOD(out, TRACE_FILE_VERSION);
+	uint32_t tickSize = sizeof(TraceTick);
+	writePOD(out, tickSize);
+}
+
+bool readTrace(std::istream& in, std::vector<TraceTick>& ticks) {
+	ticks.clear();
+	char magic[sizeof(TRACE_MAGIC)] = {};
+	uint32_t version = 0;
+	uint32_t tickSize = 0;
+	in.read(magic, sizeof(magic));
+	readPOD(in, version);
+	readPOD(in, tickSize);
+	if (!std::equal(magic, magic + sizeof(magic), TRACE_MAGIC) ||
+		version != TRACE_FILE_VERSION || tickSize != sizeof(TraceTick)) {
+		return false;
+	}
+	TraceTick t;
+	while (in.read(reinterpret_cast<char*>(&t), sizeof(t))) {
+		ticks.push_back(t);
+	}
+	return true;
+}
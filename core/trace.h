@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "rewinder.h"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+// Commands issued since the previous tick, replayed before the tick.
+constexpr uint8_t TRACE_FREEZE = 0x01; // cpt_freeze
+constexpr uint8_t TRACE_DO_CHECKPOINT = 0x02; // cpt_do_checkpoint
+
+// Everything the record/rewind logic reads from the game on one tick.
+struct TraceTick {
+	float time; // GetSecondsElapsed()
+	RewindInput input;
+	GameState state; // captureGame()
+	float ballRadius;
+	bool inGoal; // IsInGoal() at the ball's location
+	bool doubleJumped;
+	bool touched; // a car touched the ball since the previous tick
+	uint8_t wheelContacts;
+	uint8_t commands; // TRACE_* flags
+};
+
+// A trace is a header followed by raw TraceTicks; it is only meant to be read
+// back by the same build that wrote it.
+constexpr uint32_t TRACE_FILE_VERSION = 3;
+
+void writeTraceHeader(std::ostream& out);
+inline void writeTraceTick(std::ostream& out, const TraceTick& t) {
+	writePOD(out, t);
+}
+// Returns false if the stream is not a trace of this version.
+bool readTrace(std::istream& in, std::vector<TraceTick>& ticks);
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "variance.h"
+#include "fastmath.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool drawVariance(const VarianceSettings& v, Rng& rng, VarianceDraw& d) {
+	int maxVar = int(v.tot);
+	if (maxVar == 0) {
+		return false;
+	}
+	// Drawn as one batch: four amounts and the two deflection rolls.
+	float u[6];
+	rng.fillUniform(u, 6, 0, 1);
+	float carDir = u[0] * v.carDir;
+	float carSpd = (2 * u[1] - 1) * v.carSpd;
+	float carRot = v.carRot;
+	float ballDir = u[2] * v.ballDir;
+	float ballSpd = (2 * u[3] - 1) * v.ballSpd;
+	float ballRot = v.ballRot;
+	float totVar = fabsf(carDir) + fabsf(carSpd) + fabsf(carRot) + fabsf(ballDir) + fabsf(ballSpd) + fabsf(ballRot);
+	if (totVar < 0.1) {
+		return false;
+	}
+	if (totVar > maxVar) {
+		float scale = maxVar / totVar;
+		carDir *= scale;
+		carSpd *= scale;
+		carRot *= scale;
+		ballDir *= scale;
+		ballSpd *= scale;
+		ballRot *= scale;
+	}
+	d.amount = { carDir, carSpd, carRot, ballDir, ballSpd, ballRot, totVar };
+	d.carRoll = u[4] * 65532.0f - 32768.0f;
+	d.ballRoll = u[5] * 65532.0f - 32768.0f;
+	d.carSpin = randVec(rng);
+	d.ballSpin = randVec(rng);
+	return true;
+}
+
+bool applyVariance(const GameState& s, GameState& out, const VarianceSettings& v, Rng& rng,
+		VarianceSettings* applied) {
+	out = s;
+	VarianceDraw d;
+	if (!drawVariance(v, rng, d)) {
+		return false;
+	}
+	const VarianceSettings& a = d.amount;
+	if (applied != nullptr) {
+		*applied = a;
+	}
+	out.car.actorState.velocity = deflect(out.car.actorState.velocity, a.carDir, 1 + (a.carSpd / 100.0f), d.carRoll);
+	out.car.actorState.angVelocity = avgVec(out.car.actorState.angVelocity, d.carSpin, a.carRot/10.0f);
+	out.ball.velocity = deflect(out.ball.velocity, a.ballDir, 1 + (a.ballSpd / 100.0f), d.ballRoll);
+	out.ball.angVelocity = avgVec(out.ball.angVelocity, d.ballSpin, a.ballRot/10.0f);
+	return true;
+}
+
+Vec3 randVec(Rng& rng) {
+	// Normal components point every way equally; a uniform cube favors its
+	// corners.
+	float n[3];
+	rng.fillNormal(n, 3);
+	Vec3 v = { n[0], n[1], n[2] };
+	auto m = 6.0f / std::max(v.magnitude(), 1e-6f);
+	v.X *= m;
+	v.Y *= m;
+	v.Z *= m;
+	return v;
+}
+
+Vec3 avgVec(Vec3 a, Vec3 b, float amount) {
+	float amt1 = 1 - amount;
+	return (a * amt1) + (b * amount);
+}
+
+Rot VectorToRot(Vec3 vVector) {
+	Rot rRotation;
+	rRotation.Yaw = atan2f(vVector.Y, vVector.X) * UROT_PER_RAD;
+	rRotation.Pitch = atan2f(vVector.Z, sqrtf(vVector.X * vVector.X + vVector.Y * vVector.Y)) * UROT_PER_RAD;
+	rRotation.Roll = 0;
+	return rRotation;
+}
+
+Quat4 RotToQuat(Rot rot) {
+	float rotatorToRadian = ((PI_F / 180.f) * .5f) / UROT_PER_DEG;
+	float sinPitch = sinf(rot.Pitch * rotatorToRadian);
+	float cosPitch = cosf(rot.Pitch * rotatorToRadian);
+	float sinYaw = sinf(rot.Yaw * rotatorToRadian);
+	float cosYaw = cosf(rot.Yaw * rotatorToRadian);
+	float sinRoll = sinf(rot.Roll * rotatorToRadian);
+	float cosRoll = cosf(rot.Roll * rotatorToRadian);
+	Quat4 convertedQuat;
+	convertedQuat.X = (cosRoll * sinPitch * sinYaw) - (sinRoll * cosPitch * cosYaw);
+	convertedQuat.Y = (-cosRoll * sinPitch * cosYaw) - (sinRoll * cosPitch * sinYaw);
+	convertedQuat.Z = (cosRoll * cosPitch * sinYaw) - (sinRoll * sinPitch * cosYaw);
+	convertedQuat.W = (cosRoll * cosPitch * cosYaw) + (sinRoll * sinPitch * sinYaw);
+	return convertedQuat;
+}
+
+Vec3 deflect(Vec3 velocity, float dir, float speed, float roll) {
+	Quat4 velQ = RotToQuat(VectorToRot(velocity));
+	Quat4 pitchQ = RotToQuat({ dir * UROT_PER_DEG, 0, 0 });  // Deflect dir degrees
+	Quat4 rollQ = RotToQuat({ 0, 0, roll }); // Random direction
+	return rotateVec(rotateVec(rotateVec({ velocity.magnitude() * speed, 0, 0 }, pitchQ), rollQ), velQ);
+}
+
+void Vec3Batch::resize(size_t n) {
+	x.resize(n);
+	y.resize(n);
+	z.resize(n);
+}
+
+void Vec3Batch::set(size_t i, Vec3 v) {
+	x[i] = v.X;
+	y[i] = v.Y;
+	z[i] = v.Z;
+}
+
+void RotBatch::resize(size_t n) {
+	pitch.resize(n);
+	yaw.resize(n);
+	roll.resize(n);
+}
+
+void QuatBatch::resize(size_t n) {
+	x.resize(n);
+	y.resize(n);
+	z.resize(n);
+	w.resize(n);
+}
+
+// RotToQuat with fastSinCos; takes half angles in radians.
+static inline Quat4 fastHalfAnglesToQuat(float pitch, float yaw, float roll) {
+	float sinPitch, cosPitch, sinYaw, cosYaw, sinRoll, cosRoll;
+	fastSinCos(pitch, sinPitch, cosPitch);
+	fastSinCos(yaw, sinYaw, cosYaw);
+	fastSinCos(roll, sinRoll, cosRoll);
+	Quat4 q;
+	q.X = (cosRoll * sinPitch * sinYaw) - (sinRoll * cosPitch * cosYaw);
+	q.Y = (-cosRoll * sinPitch * cosYaw) - (sinRoll * cosPitch * sinYaw);
+	q.Z = (cosRoll * cosPitch * sinYaw) - (sinRoll * sinPitch * cosYaw);
+	q.W = (cosRoll * cosPitch * cosYaw) + (sinRoll * sinPitch * sinYaw);
+	return q;
+}
+
+constexpr float UROT_TO_HALF_RADIAN = 0.5f / UROT_PER_RAD;
+
+static void vectorToRotLanes(size_t n, const float* __restrict x, const float* __restrict y, const float* __restrict z,
+	float* __restrict pitch, float* __restrict yaw, float* __restrict roll) {
+	for (size_t i = 0; i < n; i++) {
+		yaw[i] = fastAtan2(y[i], x[i]) * UROT_PER_RAD;
+		pitch[i] = fastAtan2(z[i], sqrtf(x[i] * x[i] + y[i] * y[i])) * UROT_PER_RAD;
+		roll[i] = 0;
+	}
+}
+
+void VectorToRotBatch(const Vec3Batch& v, RotBatch& out) {
+	out.resize(v.size());
+	vectorToRotLanes(v.size(), v.x.data(), v.y.data(), v.z.data(), out.pitch.data(), out.yaw.data(), out.roll.data());
+}
+
+static void rotToQuatLanes(size_t n, const float* __restrict pitch, const float* __restrict yaw, const float* __restrict roll,
+	float* __restrict qx, float* __restrict qy, float* __restrict qz, float* __restrict qw) {
+	for (size_t i = 0; i < n; i++) {
+		Quat4 q = fastHalfAnglesToQuat(pitch[i] * UROT_TO_HALF_RADIAN, yaw[i] * UROT_TO_HALF_RADIAN, roll[i] * UROT_TO_HALF_RADIAN);
+		qx[i] = q.X;
+		qy[i] = q.Y;
+		qz[i] = q.Z;
+		qw[i] = q.W;
+	}
+}
+
+void RotToQuatBatch(const RotBatch& rots, QuatBatch& out) {
+	out.resize(rots.size());
+	rotToQuatLanes(rots.size(), rots.pitch.data(), rots.yaw.data(), rots.roll.data(),
+		out.x.data(), out.y.data(), out.z.data(), out.w.data());
+}
+
+// deflect() per lane.  VectorToRot's angles are in radians here, and halved
+// directly instead of through Unreal units.
+static void deflectLanes(size_t n, const float* __restrict x, const float* __restrict y, const float* __restrict z,
+	const float* __restrict dir, const float* __restrict speed, const float* __restrict roll,
+	float* __restrict ox, float* __restrict oy, float* __restrict oz) {
+	for (size_t i = 0; i < n; i++) {
+		Vec3 v = { x[i], y[i], z[i] };
+		float yaw = fastAtan2(v.Y, v.X);
+		float pitch = fastAtan2(v.Z, sqrtf(v.X * v.X + v.Y * v.Y));
+		Quat4 velQ = fastHalfAnglesToQuat(pitch * 0.5f, yaw * 0.5f, 0);
+		Quat4 pitchQ = fastHalfAnglesToQuat(dir[i] * (PI_F / 360), 0, 0);
+		Quat4 rollQ = fastHalfAnglesToQuat(0, 0, roll[i] * UROT_TO_HALF_RADIAN);
+		Vec3 d = rotateVec(rotateVec(rotateVec({ v.magnitude() * speed[i], 0, 0 }, pitchQ), rollQ), velQ);
+		ox[i] = d.X;
+		oy[i] = d.Y;
+		oz[i] = d.Z;
+	}
+}
+
+void deflectBatch(const Vec3Batch& velocity, const float* dir, const float* speed, const float* roll, Vec3Batch& out) {
+	out.resize(velocity.size());
+	deflectLanes(velocity.size(), velocity.x.data(), velocity.y.data(), velocity.z.data(), dir, speed, roll,
+		out.x.data(), out.y.data(), out.z.data());
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "random.h"
+#include "state.h"
+#include "vec.h"
+
+#include <vector>
+
+// cpt_variance_* values.
+struct VarianceSettings {
+	float carDir = 0;
+	float carSpd = 0;
+	float carRot = 0;
+	float ballDir = 0;
+	float ballSpd = 0;
+	float ballRot = 0;
+	float tot = 0;
+};
+
+Rot VectorToRot(Vec3 vVector);
+Quat4 RotToQuat(Rot rot);
+
+// Rotates velocity by dir degrees in the direction given by roll (Unreal
+// units) and scales it by speed.
+Vec3 deflect(Vec3 velocity, float dir, float speed, float roll);
+// A random direction, 6 long.
+Vec3 randVec(Rng& rng);
+Vec3 avgVec(Vec3 a, Vec3 b, float amount);
+
+// The randomness behind one applyVariance.
+struct VarianceDraw {
+	VarianceSettings amount; // scaled down to v.tot if over it; tot is the total before scaling
+	float carRoll, ballRoll; // directions to deflect in (Unreal units)
+	Vec3 carSpin, ballSpin; // randVec()s blended into the angular velocities
+};
+
+// Draws variance within v.  Returns false if there is none to apply.
+bool drawVariance(const VarianceSettings& v, Rng& rng, VarianceDraw& d);
+
+// Writes s with random variance within v applied to out.  Returns false if no
+// variance was applied.  If applied is set, it receives the variance used.
+bool applyVariance(const GameState& s, GameState& out, const VarianceSettings& v, Rng& rng,
+	VarianceSettings* applied = nullptr);
+
+// Structure-of-arrays forms of the rotation math above, for many states at
+// once.  Lanes are independent and use the approximations in fastmath.h, so
+// the loops vectorize; results stay within FAST_*_MAX_ERROR of the scalar
+// functions before it is scaled up by the magnitudes involved.
+struct Vec3Batch {
+	void resize(size_t n);
+	size_t size() const { return x.size(); }
+	Vec3 get(size_t i) const { return { x[i], y[i], z[i] }; }
+	void set(size_t i, Vec3 v);
+
+	std::vector<float> x, y, z;
+};
+
+struct RotBatch {
+	void resize(size_t n);
+	size_t size() const { return pitch.size(); }
+
+	std::vector<float> pitch, yaw, roll; // Unreal units
+};
+
+struct QuatBatch {
+	void resize(size_t n);
+	size_t size() const { return x.size(); }
+
+	std::vector<float> x, y, z, w;
+};
+
+void VectorToRotBatch(const Vec3Batch& v, RotBatch& out);
+void RotToQuatBatch(const RotBatch& rots, QuatBatch& out);
+// deflect() for each lane; dir, speed and roll hold velocity.size() values.
+// out must not be velocity.
+void deflectBatch(const Vec3Batch& velocity, const float* dir, const float* speed, const float* roll, Vec3Batch& out);
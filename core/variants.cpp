@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "variants.h"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
+
+constexpr size_t VARIANTS_MIN_PER_THREAD = 256; // fewer are not worth a thread
+
+// Variants [begin, end): draws each one's variance, then deflects all of
+// their velocities with deflectBatch.
+static void generateRange(const GameState& s, const VarianceSettings& v, bool mirror, uint64_t seed,
+		GameState* out, uint64_t* hashes, size_t begin, size_t end) {
+	size_t n = end - begin;
+	std::vector<size_t> lanes; // variant in each lane; those without variance have none
+	std::vector<VarianceDraw> draws(n);
+	Vec3Batch car, ball;
+	car.resize(n);
+	ball.resize(n);
+	std::vector<float> carDir(n), carSpeed(n), carRoll(n), ballDir(n), ballSpeed(n), ballRoll(n);
+	lanes.reserve(n);
+	GameState mirrored = s.mirror();
+	for (size_t i = begin; i < end; i++) {
+		Rng rng = Rng::stream(seed, i);
+		out[i] = mirror && rng.below(2) == 0 ? mirrored : s;
+		size_t k = lanes.size();
+		VarianceDraw& d = draws[k];
+		if (!drawVariance(v, rng, d)) {
+			continue;
+		}
+		lanes.push_back(i);
+		car.set(k, out[i].car.actorState.velocity);
+		carDir[k] = d.amount.carDir;
+		carSpeed[k] = 1 + d.amount.carSpd / 100.0f;
+		carRoll[k] = d.carRoll;
+		ball.set(k, out[i].ball.velocity);
+		ballDir[k] = d.amount.ballDir;
+		ballSpeed[k] = 1 + d.amount.ballSpd / 100.0f;
+		ballRoll[k] = d.ballRoll;
+	}
+	car.resize(lanes.size());
+	ball.resize(lanes.size());
+	Vec3Batch carOut, ballOut;
+	deflectBatch(car, carDir.data(), carSpeed.data(), carRoll.data(), carOut);
+	deflectBatch(ball, ballDir.data(), ballSpeed.data(), ballRoll.data(), ballOut);
+	for (size_t k = 0; k < lanes.size(); k++) {
+		GameState& g = out[lanes[k]];
+		const VarianceDraw& d = draws[k];
+		g.car.actorState.velocity = carOut.get(k);
+		g.car.actorState.angVelocity = avgVec(g.car.actorState.angVelocity, d.carSpin, d.amount.carRot / 10.0f);
+		g.ball.velocity = ballOut.get(k);
+		g.ball.angVelocity = avgVec(g.ball.angVelocity, d.ballSpin, d.amount.ballRot / 10.0f);
+	}
+	for (size_t i = begin; i < end; i++) {
+		hashes[i] = out[i].hash();
+	}
+}
+
+size_t generateVariants(const GameState& s, const VarianceSettings& v, bool mirror, uint64_t seed, size_t n,
+		std::vector<GameState>& out, unsigned threads) {
+	n = std::min(n, MAX_VARIANTS);
+	std::vector<GameState> variants(n);
+	std::vector<uint64_t> hashes(n);
+	threads = unsigned(std::clamp<size_t>(n / VARIANTS_MIN_PER_THREAD, 1, std::max(threads, 1u)));
+	size_t per = (n + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for (unsigned t = 1; t < threads; t++) {
+		workers.emplace_back(generateRange, std::cref(s), std::cref(v), mirror, seed,
+			variants.data(), hashes.data(), t * per, std::min(n, (t + 1) * per));
+	}
+	generateRange(s, v, mirror, seed, variants.data(), hashes.data(), 0, std::min(n, per));
+	for (auto& w : workers) {
+		w.join();
+	}
+
+	out.clear();
+	out.reserve(n);
+	std::unordered_set<uint64_t> seen;
+	seen.reserve(n);
+	for (size_t i = 0; i < n; i++) {
+		if (seen.insert(hashes[i]).second) {
+			out.push_back(variants[i]);
+		}
+	}
+	return out.size();
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "state.h"
+#include "variance.h"
+
+#include <cstdint>
+#include <vector>
+
+constexpr size_t MAX_VARIANTS = 100000; // per cpt_generate_variants
+
+// Writes up to n variants of s to out for a drill pack: each with variance
+// within v applied (as applyVariance does, but through deflectBatch), and
+// mirrored on a coin flip if mirror is set.  Variant i draws from stream i
+// of seed, so the pack depends only on the seed, not on the number of
+// threads.  Variants identical to an earlier one are dropped, keeping the
+// first; returns how many were kept.
+size_t generateVariants(const GameState& s, const VarianceSettings& v, bool mirror, uint64_t seed, size_t n,
+	std::vector<GameState>& out, unsigned threads);
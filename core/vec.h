@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cmath>
+
+// SDK-independent math types.  Layouts match BakkesMod's Vector, Rotator and
+// Quat; see state.h in the plugin for conversions.
+
+constexpr float PI_F = 3.14159265358979323846f;
+constexpr float UROT_PER_DEG = 65536.0f / 360.0f; // Unreal rotation units per degree
+constexpr float UROT_PER_RAD = 32768.0f / PI_F;
+
+struct Vec3 {
+	float X = 0;
+	float Y = 0;
+	float Z = 0;
+
+	float magnitude() const { return sqrtf(X * X + Y * Y + Z * Z); }
+};
+
+inline Vec3 operator+(Vec3 a, Vec3 b) { return { a.X + b.X, a.Y + b.Y, a.Z + b.Z }; }
+inline Vec3 operator-(Vec3 a, Vec3 b) { return { a.X - b.X, a.Y - b.Y, a.Z - b.Z }; }
+inline Vec3 operator*(Vec3 a, float f) { return { a.X * f, a.Y * f, a.Z * f }; }
+inline bool operator==(Vec3 a, Vec3 b) { return a.X == b.X && a.Y == b.Y && a.Z == b.Z; }
+inline float dot(Vec3 a, Vec3 b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+inline Vec3 cross(Vec3 a, Vec3 b) {
+	return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+}
+
+// Rotation in Unreal units (65536 per turn), like BakkesMod's Rotator.
+struct IRot {
+	int Pitch = 0;
+	int Yaw = 0;
+	int Roll = 0;
+};
+
+inline bool operator==(IRot a, IRot b) { return a.Pitch == b.Pitch && a.Yaw == b.Yaw && a.Roll == b.Roll; }
+
+// Rotator uses ints instead of floats.  Floats are better.
+struct Rot {
+	float Pitch, Yaw, Roll;
+};
+
+struct Quat4 {
+	float X = 0;
+	float Y = 0;
+	float Z = 0;
+	float W = 1;
+};
+
+inline Quat4 operator*(Quat4 a, Quat4 b) {
+	return {
+		a.W * b.X + a.X * b.W + a.Y * b.Z - a.Z * b.Y,
+		a.W * b.Y - a.X * b.Z + a.Y * b.W + a.Z * b.X,
+		a.W * b.Z + a.X * b.Y - a.Y * b.X + a.Z * b.W,
+		a.W * b.W - a.X * b.X - a.Y * b.Y - a.Z * b.Z,
+	};
+}
+
+// Same as BakkesMod's RotateVectorWithQuat.
+inline Vec3 rotateVec(Vec3 v, Quat4 q) {
+	Vec3 u = { q.X, q.Y, q.Z };
+	Vec3 t = cross(u, v) * 2.0f;
+	return v + t * q.W + cross(u, t);
+}
+
+// Wraps an angle in Unreal units to [-32768, 32767].
+inline int wrapURot(int a) {
+	return int(short(a & 0xffff));
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "events.h"
+
+// Indexed by EventId; {0}..{6} are the event's arguments.
+static const char* EVENT_FORMATS[EVENT_COUNT] = {
+	"resuming...",
+	"quick checkpoint taken",
+	"adding checkpoint {0:.0f}",
+	"at cpt; removing: {0:.0f}",
+	"at cpt; locking: {0:.0f}",
+	"at cpt; unlocking: {0:.0f}",
+	"at cpt but locked: {0:.0f}",
+	"loading quick checkpoint",
+	"loading checkpoint {0:.0f}",
+	"no checkpoint to load",
+	"could not load save file with version {0:.0f}",
+	"applying variance: ball({0:f},{1:f},{2:f}); car({3:f},{4:f},{5:f}); tot: {6:f}",
+	"similar moment {0:.0f}/{1:.0f}: {2:.2f} s ago, distance {3:.0f}",
+	"marker (kinds {0:.0f}): {1:.2f} s ago",
+	"attempt {0:.0f} at this checkpoint recorded: {1:.2f} s",
+};
+
+std::string formatEvent(const EventRecord& r) {
+	if (r.id >= EVENT_COUNT) {
+		return "unknown event " + std::to_string(r.id);
+	}
+	auto& a = r.args;
+	return fmt::format(EVENT_FORMATS[r.id], a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+}
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "core/eventlog.h"
+
+#include <string>
+
+// Formats an event from the EventLog as the message it stands for.
+std::string formatEvent(const EventRecord& r);
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "mappedfile.h"
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const std::filesystem::path& path, size_t size, bool truncate) {
+	close();
+	HANDLE h = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (h == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	file = h;
+	LARGE_INTEGER current;
+	if (!GetFileSizeEx(h, &current)) {
+		close();
+		return false;
+	}
+	size = std::max(size, size_t(current.QuadPart));
+	if (size == 0 || !map(size)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedFile::map(size_t size) {
+	// Mapping beyond the end of the file extends it.
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+		DWORD(uint64_t(size) >> 32), DWORD(uint64_t(size) & 0xffffffff), nullptr);
+	if (mapping == nullptr) {
+		return false;
+	}
+	view = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+		return false;
+	}
+	length = size;
+	return true;
+}
+
+void MappedFile::unmap() {
+	if (view != nullptr) {
+		UnmapViewOfFile(view);
+		view = nullptr;
+	}
+	if (mapping != nullptr) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	length = 0;
+}
+
+bool MappedFile::resize(size_t size) {
+	if (file == nullptr) {
+		return false;
+	}
+	if (size <= length) {
+		return true;
+	}
+	unmap();
+	if (!map(size)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+// Starts writing dirty pages to disk.
+void MappedFile::flush() {
+	if (view != nullptr) {
+		FlushViewOfFile(view, 0);
+	}
+}
+
+void MappedFile::close() {
+	unmap();
+	if (file != nullptr) {
+		CloseHandle(file);
+		file = nullptr;
+	}
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <filesystem>
+
+// A file mapped read/write into memory.  Growing the file remaps it, so
+// pointers returned by data() are invalidated by resize().
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	// Opens (creating if needed) and maps the file.  If size is 0, the file must
+	// already exist and is mapped at its current size; otherwise it is extended to
+	// at least size bytes.
+	bool open(const std::filesystem::path& path, size_t size, bool truncate);
+	bool resize(size_t size);
+	void flush();
+	void close();
+
+	bool isOpen() const { return view != nullptr; }
+	char* data() const { return view; }
+	size_t size() const { return length; }
+
+private:
+	bool map(size_t size);
+	void unmap();
+
+	void* file = nullptr;
+	void* mapping = nullptr;
+	char* view = nullptr;
+	size_t length = 0;
+};
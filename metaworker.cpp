@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "metaworker.h"
+
+#include <fstream>
+
+MetaWorker::~MetaWorker() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void MetaWorker::submit(Job next) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queued) {
+			next.reload |= job.reload;
+			next.write |= job.write;
+			next.states.insert(next.states.end(), job.states.begin(), job.states.end());
+		}
+		job = std::move(next);
+		queued = true;
+		submitted++;
+		done = false;
+		if (!worker.joinable()) {
+			worker = std::thread(&MetaWorker::run, this);
+		}
+	}
+	wake.notify_one();
+}
+
+bool MetaWorker::poll(Result& out) {
+	if (!done.load(std::memory_order_acquire)) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!done || resultJob != submitted) {
+		return false;
+	}
+	out = std::move(result);
+	done = false;
+	return true;
+}
+
+void MetaWorker::run() {
+	while (true) {
+		Job j;
+		uint64_t id;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return queued || stopping; });
+			if (!queued) {
+				return;
+			}
+			j = std::move(job);
+			job = Job();
+			queued = false;
+			id = submitted;
+		}
+
+		if (j.reload) {
+			std::ifstream in(j.path, std::ios::binary);
+			readMetaFile(in, cache);
+		}
+		Result r;
+		size_t computed = cacheMeta(j.states, cache, std::thread::hardware_concurrency());
+		if (lookupMeta(j.keys, cache, r.meta) && (computed > 0 || j.write)) {
+			std::ofstream out(j.path, std::ios::binary | std::ios::out | std::ios::trunc);
+			writeMetaFile(out, j.keys, r.meta);
+		}
+		r.mirrors.reserve(j.unmirrored.size());
+		for (const GameState& s : j.unmirrored) {
+			r.mirrors.push_back(s.mirror());
+		}
+		r.indices = std::move(j.mirrors);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (id == submitted) {
+			result = std::move(r);
+			resultJob = id;
+			done = true;
+		}
+	}
+}
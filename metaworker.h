@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "core/metadata.h"
+#include "core/state.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+// Keeps checkpoint metadata, its cache file and mirror images up to date on a
+// worker thread, so saving or loading checkpoints does not wait on them.  The
+// game thread submits the checkpoints' hashes after each change, with copies
+// of only the states the worker has not been sent before, and picks up the
+// results with poll().  The mutex is only held to hand jobs and results over.
+class MetaWorker {
+public:
+	~MetaWorker(); // Finishes the pending job, so the cache file is saved.
+
+	struct Job {
+		std::vector<uint64_t> keys; // GameState::hash() of each checkpoint
+		// States whose metadata is not cached yet; after a reload, every one.
+		std::vector<GameState> states;
+		std::filesystem::path path; // of the cache file
+		bool reload = false; // read the cache file first
+		bool write = false; // save the cache even if nothing was computed
+		std::vector<size_t> mirrors; // indices of the mirrors wanted
+		std::vector<GameState> unmirrored; // unmirrored[j] is checkpoints[mirrors[j]]
+	};
+	struct Result {
+		std::vector<CheckpointMeta> meta; // for each checkpoint; empty if some states never arrived
+		std::vector<size_t> indices;
+		std::vector<GameState> mirrors; // mirrors[j] mirrors checkpoints[indices[j]]
+	};
+
+	// Replaces any job not started yet; its reload, write and states still
+	// apply.
+	void submit(Job job);
+	// Moves out the results of the last job submitted, if it has finished.
+	bool poll(Result& out);
+
+private:
+	void run();
+
+	std::atomic<bool> done = false; // a current result is waiting
+	std::mutex mutex; // guards everything below
+	std::condition_variable wake;
+	std::thread worker;
+	bool stopping = false;
+	bool queued = false;
+	Job job;
+	uint64_t submitted = 0; // jobs
+	uint64_t resultJob = 0; // the job result is from
+	Result result;
+	MetaCache cache; // worker thread only
+};
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "pipeline.h"
+
+#include <chrono>
+
+RecordPipeline::~RecordPipeline() {
+	stop();
+}
+
+void RecordPipeline::addStage(PipelineStage* stage) {
+	stage->pipeline = this;
+	stages.push_back(stage);
+}
+
+void RecordPipeline::start() {
+	stop();
+	stopping = false;
+	worker = std::thread(&RecordPipeline::run, this);
+}
+
+void RecordPipeline::stop() {
+	if (!worker.joinable()) {
+		return;
+	}
+	stopping = true;
+	worker.join();
+}
+
+bool RecordPipeline::push(const Snapshot& s) {
+	if (!ring.push(s)) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	size_t d = ring.size();
+	if (d > maxDepth.load(std::memory_order_relaxed)) {
+		maxDepth.store(d, std::memory_order_relaxed); // only the producer writes this
+	}
+	return true;
+}
+
+void RecordPipeline::send(const Snapshot& m) {
+	if (!worker.joinable()) {
+		m.stage->control(m);
+		return;
+	}
+	while (!ring.push(m)) {
+		std::this_thread::yield();
+	}
+}
+
+void RecordPipeline::run() {
+	Snapshot s;
+	while (true) {
+		bool done = stopping;
+		bool any = false;
+		while (ring.pop(s)) {
+			if (s.kind != MessageKind::SNAPSHOT) {
+				s.stage->control(s);
+			} else {
+				for (auto stage : stages) {
+					stage->consume(s);
+				}
+			}
+			any = true;
+		}
+		if (done) {
+			return;
+		}
+		if (!any) {
+			// Snapshots arrive at most every 10ms; no need to spin.
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
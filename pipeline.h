@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "core/state.h"
+#include "spscring.h"
+
+#include <atomic>
+#include <thread>
+
+class PipelineStage;
+class RecordPipeline;
+
+enum class MessageKind : uint8_t {
+	SNAPSHOT, // passed to every stage's consume()
+	START, // the fields below are up to the stage
+	STOP,
+	UPDATE,
+};
+
+// A snapshot as recorded by record(), or a control message for one stage.
+// Control messages share the ring with snapshots so a stage sees them in the
+// order they were sent, and does its setup and flushing on the pipeline
+// thread.
+struct Snapshot {
+	GameState state;
+	float time; // seconds elapsed in the game event
+	MessageKind kind = MessageKind::SNAPSHOT;
+	PipelineStage* stage = nullptr; // receiver of a control message
+	uint64_t arg = 0;
+};
+
+// Work done with each recorded snapshot off the game thread.
+class PipelineStage {
+public:
+	virtual ~PipelineStage() = default;
+	// Called on the pipeline thread for every snapshot, in order.
+	virtual void consume(const Snapshot& s) = 0;
+	// Called on the pipeline thread for each message sent to this stage.
+	virtual void control(const Snapshot&) {}
+
+protected:
+	RecordPipeline* pipeline = nullptr; // set by addStage()
+	friend class RecordPipeline;
+};
+
+// Hands snapshots from the PlayerMove hook to a worker thread which runs them
+// through each stage.  push() never blocks or allocates; if the worker falls
+// more than the ring size behind, new snapshots are dropped and counted.
+class RecordPipeline {
+public:
+	~RecordPipeline();
+
+	// Stages must be added before start().
+	void addStage(PipelineStage* stage);
+	void start();
+	void stop(); // Drains the queue before returning.
+
+	bool push(const Snapshot& s);
+	// Unlike push(), never drops the message: waits for room if the ring is
+	// full, and calls the stage directly if the worker is not running.
+	void send(const Snapshot& m);
+
+	uint64_t drops() const { return dropped; }
+	size_t depth() const { return ring.size(); }
+	size_t peakDepth() const { return maxDepth; }
+
+private:
+	void run();
+
+	static constexpr size_t RING_SIZE = 4096; // ~40s at the finest snapshot interval
+	SpscRing<Snapshot, RING_SIZE> ring;
+	std::vector<PipelineStage*> stages;
+	std::thread worker;
+	std::atomic<bool> stopping = false;
+	std::atomic<uint64_t> dropped = 0;
+	std::atomic<size_t> maxDepth = 0;
+};
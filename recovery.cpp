@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "recovery.h"
+
+#include <atomic>
+
+constexpr uint32_t RECOVERY_FILE_MAGIC = 0x52435043; // "CPCR"
+constexpr uint32_t RECOVERY_FILE_VERSION = 1;
+constexpr float WRITE_PERIOD = 5.0f; // seconds of game time between writes
+
+struct RecoveryHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	float interval;
+	uint64_t sequence; // set before a write starts; writes are fenced in order
+	uint64_t total; // snapshots ever written; the ring holds the last min(total, capacity)
+	uint64_t capacity;
+	uint32_t hasQuickCheckpoint;
+	uint32_t clean;
+	GameState quickCheckpoint;
+	uint64_t sequenceEnd; // set to sequence once the write is complete
+};
+
+static std::filesystem::path filePath(const std::filesystem::path& base, int i) {
+	auto p = base;
+	p += std::to_string(i);
+	return p;
+}
+
+void RecoveryWriter::start(float interval, size_t cap) {
+	requested = true;
+	Snapshot m = {};
+	m.time = interval;
+	m.kind = MessageKind::START;
+	m.stage = this;
+	m.arg = cap;
+	pipeline->send(m);
+}
+
+void RecoveryWriter::stop(bool clean) {
+	if (!requested) {
+		return;
+	}
+	requested = false;
+	Snapshot m = {};
+	m.kind = MessageKind::STOP;
+	m.stage = this;
+	m.arg = clean;
+	pipeline->send(m);
+}
+
+void RecoveryWriter::setQuickCheckpoint(bool has, const GameState& s) {
+	Snapshot m = {};
+	m.state = s;
+	m.kind = MessageKind::UPDATE;
+	m.stage = this;
+	m.arg = has;
+	pipeline->send(m);
+}
+
+void RecoveryWriter::control(const Snapshot& m) {
+	if (m.kind == MessageKind::START) {
+		begin(m.time, size_t(m.arg));
+	} else if (m.kind == MessageKind::STOP) {
+		end(m.arg != 0);
+	} else if (m.kind == MessageKind::UPDATE) {
+		hasQuick = m.arg != 0;
+		quick = m.state;
+	}
+}
+
+void RecoveryWriter::begin(float interval, size_t cap) {
+	end(true);
+	snapshotInterval = interval;
+	capacity = std::max<size_t>(cap, 1);
+	fileTotals[0] = fileTotals[1] = 0;
+	nextFile = 0;
+	sequence = 0;
+	total = 0;
+	staging.clear();
+	stagingFirst = 0;
+	lastWriteTime = 0;
+	running = true;
+}
+
+void RecoveryWriter::end(bool clean) {
+	if (!running) {
+		return;
+	}
+	for (auto& file : files) {
+		if (file.isOpen() && clean) {
+			reinterpret_cast<RecoveryHeader*>(file.data())->clean = 1;
+			file.flush();
+		}
+		file.close();
+	}
+	running = false;
+}
+
+void RecoveryWriter::consume(const Snapshot& s) {
+	if (!running) {
+		return;
+	}
+	staging.push_back(s.state);
+	total++;
+	if (s.time - lastWriteTime >= WRITE_PERIOD || s.time < lastWriteTime) {
+		lastWriteTime = s.time;
+		write();
+	}
+}
+
+void RecoveryWriter::write() {
+	auto& file = files[nextFile];
+	if (!file.isOpen()) {
+		size_t size = sizeof(RecoveryHeader) + capacity * sizeof(GameState);
+		if (!file.open(filePath(basePath, nextFile), size, true)) {
+			running = false;
+			return;
+		}
+		auto header = reinterpret_cast<RecoveryHeader*>(file.data());
+		*header = RecoveryHeader();
+		header->magic = RECOVERY_FILE_MAGIC;
+		header->version = RECOVERY_FILE_VERSION;
+		header->recordSize = sizeof(GameState);
+		header->interval = snapshotInterval;
+		header->capacity = capacity;
+	}
+	auto header = reinterpret_cast<RecoveryHeader*>(file.data());
+	auto records = reinterpret_cast<GameState*>(file.data() + sizeof(RecoveryHeader));
+	// A crash between these stores leaves sequence != sequenceEnd on disk; the
+	// fences keep the compiler and CPU from reordering the body around them.
+	header->sequence = ++sequence;
+	std::atomic_thread_fence(std::memory_order_release);
+	uint64_t first = std::max(fileTotals[nextFile], total - std::min<uint64_t>(total, capacity));
+	for (uint64_t n = first; n < total; n++) {
+		records[n % capacity] = staging[n - stagingFirst];
+	}
+	header->total = total;
+	header->hasQuickCheckpoint = hasQuick;
+	header->quickCheckpoint = quick;
+	header->clean = 0;
+	std::atomic_thread_fence(std::memory_order_release);
+	header->sequenceEnd = sequence;
+	file.flush();
+	fileTotals[nextFile] = total;
+	nextFile ^= 1;
+
+	// Drop the snapshots both files have.
+	uint64_t keep = std::min(fileTotals[0], fileTotals[1]);
+	staging.erase(staging.begin(), staging.begin() + (keep - stagingFirst));
+	stagingFirst = keep;
+}
+
+// Returns the header if the file is complete and matches this build.
+static const RecoveryHeader* validHeader(const MappedFile& file) {
+	if (file.size() < sizeof(RecoveryHeader)) {
+		return nullptr;
+	}
+	auto header = reinterpret_cast<const RecoveryHeader*>(file.data());
+	if (header->magic != RECOVERY_FILE_MAGIC || header->version != RECOVERY_FILE_VERSION ||
+		header->recordSize != sizeof(GameState) || header->sequence != header->sequenceEnd ||
+		file.size() < sizeof(RecoveryHeader) + header->capacity * sizeof(GameState)) {
+		return nullptr;
+	}
+	return header;
+}
+
+bool RecoveryWriter::recover(std::filesystem::path path, std::filesystem::path recoveredPath) {
+	int best = -1;
+	uint64_t bestSequence = 0;
+	bool clean = true;
+	for (int i = 0; i < 2; i++) {
+		if (!std::filesystem::exists(filePath(path, i))) {
+			continue;
+		}
+		MappedFile file;
+		if (!file.open(filePath(path, i), 0, false)) {
+			continue;
+		}
+		auto header = validHeader(file);
+		if (header != nullptr && header->sequence >= bestSequence) {
+			best = i;
+			bestSequence = header->sequence;
+			clean = header->clean != 0;
+		}
+	}
+	if (best == -1 || clean) {
+		return false;
+	}
+	std::error_code ec;
+	std::filesystem::rename(filePath(path, best), recoveredPath, ec);
+	return !ec;
+}
+
+bool RecoveryWriter::load(std::filesystem::path path, float& interval, std::vector<GameState>& history,
+		bool& hasQuickCheckpoint, GameState& quickCheckpoint) {
+	if (!std::filesystem::exists(path)) {
+		return false;
+	}
+	MappedFile file;
+	if (!file.open(path, 0, false)) {
+		return false;
+	}
+	auto header = validHeader(file);
+	if (header == nullptr) {
+		return false;
+	}
+	auto records = reinterpret_cast<const GameState*>(file.data() + sizeof(RecoveryHeader));
+	uint64_t count = std::min(header->total, header->capacity);
+	history.clear();
+	history.reserve(count);
+	for (uint64_t n = header->total - count; n < header->total; n++) {
+		history.push_back(records[n % header->capacity]);
+	}
+	interval = header->interval;
+	hasQuickCheckpoint = header->hasQuickCheckpoint != 0;
+	quickCheckpoint = header->quickCheckpoint;
+	return true;
+}
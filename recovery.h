@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "core/state.h"
+#include "mappedfile.h"
+#include "pipeline.h"
+
+#include <filesystem>
+
+// Periodically saves the tail of history and the quick checkpoint so they can
+// be restored after a crash.  Saves alternate between a pair of mapped files,
+// each holding a ring of the last <capacity> snapshots and a sequence number,
+// so one of them is always complete.  Each save copies only the snapshots
+// that file has not seen yet.  The public methods are called from the game
+// thread and only queue a message; everything else runs on the pipeline
+// thread.
+class RecoveryWriter : public PipelineStage {
+public:
+	// path is the base name; the pair of files appends "0" and "1".
+	void setPath(std::filesystem::path p) { basePath = p; } // Before the pipeline starts.
+	void start(float interval, size_t capacity);
+	// If clean, marks the files so they are not offered for restoring.
+	void stop(bool clean);
+	bool active() const { return requested; }
+
+	// Saved with the next write.
+	void setQuickCheckpoint(bool has, const GameState& s);
+
+	void consume(const Snapshot& s) override;
+	void control(const Snapshot& m) override;
+
+	// If the newest complete file of the pair was not closed cleanly, moves it
+	// to recoveredPath and returns true.
+	static bool recover(std::filesystem::path path, std::filesystem::path recoveredPath);
+	static bool load(std::filesystem::path path, float& interval, std::vector<GameState>& history,
+		bool& hasQuickCheckpoint, GameState& quickCheckpoint);
+
+private:
+	void begin(float interval, size_t capacity);
+	void end(bool clean);
+	void write();
+
+	bool requested = false; // game thread only
+	bool running = false;
+	std::filesystem::path basePath;
+	float snapshotInterval = 0;
+	size_t capacity = 0;
+	MappedFile files[2];
+	uint64_t fileTotals[2] = {}; // snapshots each file has seen
+	int nextFile = 0;
+	uint64_t sequence = 0;
+	uint64_t total = 0; // snapshots consumed
+	std::vector<GameState> staging; // snapshots after stagingFirst; not yet in both files
+	uint64_t stagingFirst = 0;
+	float lastWriteTime = 0;
+	bool hasQuick = false;
+	GameState quick;
+};
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "session.h"
+
+static_assert(std::is_trivially_copyable_v<GameState>, "GameState is copied to the session file as raw bytes");
+
+constexpr uint32_t SESSION_FILE_MAGIC = 0x52535043; // "CPSR"
+constexpr uint32_t SESSION_FILE_VERSION = 1;
+constexpr size_t BATCH_SIZE = 2048; // snapshots per write
+constexpr size_t FILE_CHUNK = 16 * 1024 * 1024; // file growth increment (bytes)
+
+struct SessionHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	float interval;
+	uint64_t count;
+};
+
+void SessionRecorder::start(float interval) {
+	requested = true;
+	Snapshot m = {};
+	m.time = interval;
+	m.kind = MessageKind::START;
+	m.stage = this;
+	pipeline->send(m);
+}
+
+void SessionRecorder::stop() {
+	if (!requested) {
+		return;
+	}
+	requested = false;
+	Snapshot m = {};
+	m.kind = MessageKind::STOP;
+	m.stage = this;
+	pipeline->send(m);
+}
+
+void SessionRecorder::control(const Snapshot& m) {
+	if (m.kind == MessageKind::START) {
+		begin(m.time);
+	} else if (m.kind == MessageKind::STOP) {
+		end();
+	}
+}
+
+// Snapshots still in the ring from a previous session were consumed before
+// this message, so they went to the previous file.  The new file itself is
+// opened by the first snapshot.
+void SessionRecorder::begin(float interval) {
+	end();
+	std::lock_guard<std::mutex> lock(mutex);
+	snapshotInterval = interval;
+	written = 0;
+	recorded = 0;
+	batch.clear();
+	batch.reserve(BATCH_SIZE);
+	running = true;
+}
+
+void SessionRecorder::end() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!running) {
+		return;
+	}
+	writeBatch();
+	file.close();
+	running = false;
+}
+
+void SessionRecorder::consume(const Snapshot& s) {
+	if (!running) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!running) {
+		return;
+	}
+	if (!file.isOpen()) {
+		if (!file.open(path, FILE_CHUNK, true)) {
+			running = false;
+			return;
+		}
+		*reinterpret_cast<SessionHeader*>(file.data()) =
+			{ SESSION_FILE_MAGIC, SESSION_FILE_VERSION, sizeof(GameState), snapshotInterval, 0 };
+	}
+	batch.push_back(s.state);
+	recorded = written + batch.size();
+	if (batch.size() == BATCH_SIZE) {
+		writeBatch();
+	}
+}
+
+bool SessionRecorder::read(size_t first, size_t count, std::vector<GameState>& out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!file.isOpen() || first + count > written + batch.size()) {
+		return false;
+	}
+	size_t end = first + count;
+	size_t fileEnd = std::min<size_t>(end, written);
+	auto records = reinterpret_cast<const GameState*>(file.data() + sizeof(SessionHeader));
+	out.clear();
+	if (first < fileEnd) {
+		out.assign(records + first, records + fileEnd);
+	}
+	if (end > written) {
+		size_t batchFirst = std::max<size_t>(first, written) - written;
+		out.insert(out.end(), batch.begin() + batchFirst, batch.begin() + (end - written));
+	}
+	return true;
+}
+
+size_t SessionRecorder::memoryUsage() const {
+	return requested ? BATCH_SIZE * sizeof(GameState) : 0;
+}
+
+void SessionRecorder::writeBatch() {
+	if (!file.isOpen() || batch.empty()) {
+		return;
+	}
+	size_t count = written;
+	size_t needed = sizeof(SessionHeader) + (count + batch.size()) * sizeof(GameState);
+	if (needed > file.size() && !file.resize(needed + FILE_CHUNK)) {
+		running = false;
+		return;
+	}
+	memcpy(file.data() + sizeof(SessionHeader) + count * sizeof(GameState), batch.data(), batch.size() * sizeof(GameState));
+	reinterpret_cast<SessionHeader*>(file.data())->count = count + batch.size();
+	file.flush();
+	written = count + batch.size();
+	batch.clear();
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "core/state.h"
+#include "mappedfile.h"
+#include "pipeline.h"
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+
+// Records every snapshot of a freeplay session to an append-only file so
+// history older than cpt_history_length can be reloaded.  Snapshots arrive on
+// the pipeline thread and are written to the mapped file in large batches.
+// start() and stop() are called from the game thread and only queue a
+// message; the pipeline thread opens, writes and closes the file.
+class SessionRecorder : public PipelineStage {
+public:
+	void setPath(std::filesystem::path p) { path = p; } // Before the pipeline starts.
+	void start(float interval);
+	void stop(); // Writes the pending batch.
+	bool active() const { return requested; }
+
+	void consume(const Snapshot& s) override;
+	void control(const Snapshot& m) override;
+
+	// Reads snapshots [first, first + count) back from the file and the
+	// pending batch.
+	bool read(size_t first, size_t count, std::vector<GameState>& out);
+
+	// Number of snapshots recorded, including the pending batch.
+	size_t size() const { return recorded; }
+	float interval() const { return snapshotInterval; }
+	size_t memoryUsage() const;
+
+private:
+	void begin(float interval);
+	void end();
+	void writeBatch();
+
+	bool requested = false; // game thread only
+	std::atomic<bool> running = false;
+	std::atomic<size_t> written = 0;
+	std::atomic<size_t> recorded = 0;
+	std::atomic<float> snapshotInterval = 0;
+
+	std::mutex mutex; // guards everything below
+	std::filesystem::path path;
+	std::vector<GameState> batch;
+	MappedFile file; // remapped as it grows
+};
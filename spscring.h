@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+// Fixed-size lock-free queue for exactly one producer thread and one consumer
+// thread.  N must be a power of two.
+template<typename T, size_t N>
+class SpscRing {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+public:
+	SpscRing() : items(new T[N]) {}
+
+	// Producer only.  Returns false (without blocking) if the ring is full.
+	bool push(const T& t) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == N) {
+			return false;
+		}
+		items[h & (N - 1)] = t;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only.  Returns false if the ring is empty.
+	bool pop(T& t) {
+		size_t tl = tail.load(std::memory_order_relaxed);
+		if (tl == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		t = items[tl & (N - 1)];
+		tail.store(tl + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Approximate when called from neither thread.
+	size_t size() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	static constexpr size_t capacity() { return N; }
+
+private:
+	std::unique_ptr<T[]> items;
+	alignas(64) std::atomic<size_t> head = 0; // next slot to write
+	alignas(64) std::atomic<size_t> tail = 0; // next slot to read
+};
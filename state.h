@@ -11,58 +11,25 @@
 #include "bakkesmod/plugin/bakkesmodplugin.h"
 #include "bakkesmod/plugin/pluginwindow.h"
 
-class ActorState {
-public:
-	Vector location;
-	Vector velocity;
-	Rotator rotation;
-	Vector angVelocity;
-
-	ActorState();
-	ActorState(ActorWrapper a);
-	ActorState(ActorState lh, ActorState rh, float percent);
-	ActorState(std::istream& in);
-
-	void write(std::ostream& out) const;
-	void apply(ActorWrapper a) const;
-	ActorState mirror() const;
-};
-
-class CarState {
-public:
-	ActorState actorState;
-	float boostAmount;
-	bool hasDodge;
-	float lastJumped; // cannot apply; used to reset dodge in record().
-	long boosting;
-
-	CarState();
-	CarState(CarWrapper c);
-	CarState(CarWrapper c, float lastJumpedTime);
-	CarState(CarState lh, CarState rh, float percent);
-	CarState(std::istream& in);
-
-	void write(std::ostream& out) const;
-	void apply(CarWrapper c, bool showBoost) const;
-	CarState mirror() const;
-};
-
-class GameState {
-public:
-	ActorState ball;
-	CarState car;
-	float time; // -1 if not in a timed mode
-
-	GameState();
-	GameState(std::shared_ptr<GameWrapper> gw);
-	GameState(std::shared_ptr<GameWrapper> gw, float lastJumpedTime);
-	GameState(CarWrapper cw, BallWrapper bw);
-	GameState(const GameState& lh, const GameState& rh, float percent);
-	GameState(std::istream& in);
-	GameState(std::string str);
-
-	void write(std::ostream& out) const;
-	void apply(std::shared_ptr<GameWrapper> gw, bool showBoost) const;
-	const std::string toString() const;
-	GameState mirror() const;
-};
+#include "core/rewinder.h"
+#include "core/state.h"
+
+// Adapters between the BakkesMod wrappers and the SDK-independent state in
+// core/state.h.
+
+inline Vec3 toVec3(const Vector& v) { return { v.X, v.Y, v.Z }; }
+inline Vector toVector(const Vec3& v) { return Vector(v.X, v.Y, v.Z); }
+inline IRot toIRot(const Rotator& r) { return { r.Pitch, r.Yaw, r.Roll }; }
+inline Rotator toRotator(const IRot& r) { return Rotator(r.Pitch, r.Yaw, r.Roll); }
+RewindInput toRewindInput(const ControllerInput& ci);
+
+ActorState captureActor(ActorWrapper a);
+CarState captureCar(CarWrapper c);
+CarState captureCar(CarWrapper c, float lastJumpedTime);
+GameState captureGame(std::shared_ptr<GameWrapper> gw);
+GameState captureGame(std::shared_ptr<GameWrapper> gw, float lastJumpedTime);
+GameState captureGame(CarWrapper cw, BallWrapper bw);
+
+void applyActor(const ActorState& s, ActorWrapper a);
+void applyCar(const CarState& s, CarWrapper c, bool showBoost);
+void applyGame(const GameState& s, std::shared_ptr<GameWrapper> gw, bool showBoost);
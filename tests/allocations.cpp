@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Drives the Rewinder through a scripted freeplay session, the way the
+// plugin's PlayerMove hook does, and fails if anything allocates once history
+// has filled.  Each 20 s cycle plays, freezes, rewinds, previews the future
+// and resumes; resuming takes a quick checkpoint and the ball landing resets
+// to it.
+
+#include "core/rewinder.h"
+#include "core/variance.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+constexpr float TICK_RATE = 120; // PlayerMove calls per second
+constexpr float INTERVAL = 0.010f; // s between snapshots
+constexpr float HISTORY_TIME = 10; // s
+constexpr float WARM_UP_TIME = HISTORY_TIME + 1; // s; history is full
+constexpr float SESSION_TIME = 300; // s
+
+static uint64_t allocations = 0;
+
+void* operator new(size_t size) {
+	allocations++;
+	if (void* p = malloc(size == 0 ? 1 : size)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	allocations++;
+	if (void* p = malloc(size == 0 ? 1 : size)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+// The game at time t: the ball bounces around the field and the car drives
+// in a circle.
+class StubWorld : public World {
+public:
+	explicit StubWorld(Rewinder& r) : r(r) {}
+
+	GameState capture() override { return state; }
+	GameState capture(float lastJumped) override {
+		GameState s = state;
+		s.car.lastJumped = lastJumped;
+		return s;
+	}
+	Vec3 ballLocation() override { return state.ball.location; }
+	Vec3 ballVelocity() override { return state.ball.velocity; }
+	float ballRadius() override { return 92.75f; }
+	bool isInGoal(Vec3) override { return false; }
+	bool carDoubleJumped() override { return false; }
+	int carWheelContacts() override { return 4; }
+	RewindInput input() override { return in; }
+	void takeDodge() override {}
+	void applyBall(const ActorState&) override {}
+	void frozenChanged(bool, bool) override {}
+	void resetShot() override {
+		if (r.hasQuickCheckpoint) {
+			load(r.quickCheckpoint);
+		}
+	}
+	void recorded(const GameState&, float) override {}
+
+	void setTime(float t) {
+		state.ball.location = { 3000 * sinf(t * 0.3f), 4000 * cosf(t * 0.2f), 93 + 1200 * fabsf(sinf(t * 1.5f)) };
+		state.ball.velocity = { 900 * cosf(t * 0.3f), -800 * sinf(t * 0.2f), 1800 * cosf(t * 1.5f) };
+		state.ball.angVelocity = { 1, 2, 0.5f };
+		state.car.actorState.location = { 2000 * cosf(t * 0.5f), 2000 * sinf(t * 0.5f), 17 };
+		state.car.actorState.velocity = { -1000 * sinf(t * 0.5f), 1000 * cosf(t * 0.5f), 0 };
+		state.car.boostAmount = 0.33f;
+		state.car.hasDodge = true;
+		state.car.lastJumped = -1;
+		state.time = -1;
+	}
+
+	void load(const GameState& s) {
+		r.load(s);
+		r.rewindMode = true;
+		r.freezeBall = true;
+	}
+
+	GameState state;
+	RewindInput in;
+
+private:
+	Rewinder& r;
+};
+
+int main() {
+	Rewinder r;
+	r.interval = INTERVAL;
+	r.previewFuture = true;
+	r.resetOnBallGround = true;
+	r.setCapacity(size_t(HISTORY_TIME / INTERVAL));
+	r.attempts.setCapacity(1024 * 1024);
+	StubWorld world(r);
+	VarianceSettings variance;
+	variance.carDir = variance.ballDir = variance.ballSpd = 10;
+	Rng rng(1);
+	GameState varied;
+
+	uint64_t before = 0;
+	size_t n = size_t(SESSION_TIME * TICK_RATE);
+	for (size_t i = 0; i < n; i++) {
+		float t = i / TICK_RATE;
+		if (t >= WARM_UP_TIME && before == 0) {
+			before = allocations;
+		}
+		float p = fmodf(t, 20);
+		world.setTime(t);
+		world.in = RewindInput();
+		if (p < 12 || p >= 17) {
+			world.in.throttle = 1;
+		} else if (p < 15) {
+			world.in.steer = -1;
+		} else if (p < 16) {
+			world.in.steer = 1; // Into the predicted future.
+		}
+		if (!r.rewindMode && p >= 12 && p < 17 && r.history.size() > 0) {
+			world.load(r.history.back());
+		}
+
+		if (r.rewindMode) {
+			if (r.rewind(world, t, world.in)) {
+				applyVariance(r.latest, varied, variance, rng);
+			}
+		} else {
+			r.record(world, t);
+		}
+	}
+
+	uint64_t allocated = allocations - before;
+	printf("%llu allocations after %.0f s of warm-up\n", (unsigned long long)allocated, WARM_UP_TIME);
+	return allocated == 0 ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Checks that predictLandings agrees with predictBall for every ball of
+// mixed batches: balls that land on the first step, late in the flight, at
+// the horizon or not at all, in batches small and large enough to be
+// compacted.
+
+#include "core/ballistics.h"
+#include "core/random.h"
+
+#include <cmath>
+#include <cstdio>
+
+// Returns the number of balls whose batch landing differs from predictBall.
+static int check(const char* name, BallBatch batch, float horizon) {
+	BallBatch expected = batch;
+	predictLandings(batch, BALL_RADIUS, horizon);
+	int failures = 0;
+	for (size_t i = 0; i < batch.size(); i++) {
+		BallPrediction p = predictBall({ expected.x[i], expected.y[i], expected.z[i] },
+			{ expected.vx[i], expected.vy[i], expected.vz[i] }, BALL_RADIUS, horizon, BALL_GROUND);
+		float landTime = p.event == BALL_GROUND ? p.time : -1;
+		bool ok = fabsf(batch.landTime[i] - landTime) < 1e-4f;
+		if (ok && landTime >= 0) {
+			ok = fabsf(batch.x[i] - p.location.X) < 0.01f && fabsf(batch.y[i] - p.location.Y) < 0.01f;
+		}
+		if (!ok) {
+			printf("%s: ball %zu of %zu: batch lands at %.4f s (%.2f, %.2f), predictBall at %.4f s (%.2f, %.2f)\n",
+				name, i, batch.size(), batch.landTime[i], batch.x[i], batch.y[i], landTime, p.location.X, p.location.Y);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int main() {
+	int failures = 0;
+
+	// One low ball among many that outlast the horizon: it lands after the
+	// last compaction.
+	BallBatch late;
+	for (int i = 0; i < 99; i++) {
+		late.add({ 0, 0, 1900 }, { 0, 0, 0 });
+	}
+	late.add({ 0, 0, 150 }, { 0, 0, 0 });
+	failures += check("late", late, 1.0f);
+
+	Rng rng(7);
+	for (size_t n : { 1, 3, 16, 100, 1000 }) {
+		for (float horizon : { 0.0f, 0.5f, 1.0f, 3.0f }) {
+			BallBatch batch;
+			for (size_t i = 0; i < n; i++) {
+				batch.add({ rng.uniform(-4000, 4000), rng.uniform(-5000, 5000), rng.uniform(93, 1950) },
+					{ rng.uniform(-2000, 2000), rng.uniform(-2000, 2000), rng.uniform(-1500, 1500) });
+			}
+			char name[64];
+			snprintf(name, sizeof(name), "random %zu, horizon %.1f", n, horizon);
+			failures += check(name, batch, horizon);
+		}
+	}
+
+	printf("%d mismatched landings\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Checks the largest differences between the batch rotation kernels (and the
+// approximations under them) and the scalar math, over random inputs, against
+// their bounds.
+
+#include "core/fastmath.h"
+#include "core/random.h"
+#include "core/variance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+constexpr size_t N = 100000;
+
+static int failures = 0;
+
+static void report(const char* name, double error, double bound) {
+	printf("%-24s max error %.3g (bound %.3g)%s\n", name, error, bound, error <= bound ? "" : " FAILED");
+	failures += error <= bound ? 0 : 1;
+}
+
+int main() {
+	Rng rng(5);
+
+	double sinCosError = 0;
+	double atan2Error = 0;
+	for (size_t i = 0; i < N; i++) {
+		float x = i % 2 == 0 ? rng.uniform(-4, 4) : rng.uniform(-1e4f, 1e4f);
+		float s, c;
+		fastSinCos(x, s, c);
+		sinCosError = std::max({ sinCosError, std::abs(s - sin(double(x))), std::abs(c - cos(double(x))) });
+		float y = rng.uniform(-1000, 1000);
+		x = rng.uniform(-1000, 1000);
+		atan2Error = std::max(atan2Error, std::abs(fastAtan2(y, x) - atan2(double(y), double(x))));
+	}
+	report("fastSinCos", sinCosError, FAST_SINCOS_MAX_ERROR);
+	report("fastAtan2", atan2Error, FAST_ATAN2_MAX_ERROR);
+
+	Vec3Batch velocity;
+	RotBatch rots;
+	velocity.resize(N);
+	rots.resize(N);
+	std::vector<float> dir(N), speed(N), roll(N);
+	for (size_t i = 0; i < N; i++) {
+		velocity.set(i, { rng.uniform(-2000, 2000), rng.uniform(-2000, 2000), rng.uniform(-2000, 2000) });
+		rots.pitch[i] = float(int(rng.uniform(-16384, 16384)));
+		rots.yaw[i] = float(int(rng.uniform(-32768, 32767)));
+		rots.roll[i] = float(int(rng.uniform(-32768, 32767)));
+		dir[i] = rng.uniform(0, 30);
+		speed[i] = rng.uniform(0.5f, 1.5f);
+		roll[i] = rng.uniform(-32768, 32764);
+	}
+	QuatBatch quats;
+	RotToQuatBatch(rots, quats);
+	RotBatch found;
+	VectorToRotBatch(velocity, found);
+	Vec3Batch deflected;
+	deflectBatch(velocity, dir.data(), speed.data(), roll.data(), deflected);
+	double quatError = 0;
+	double rotError = 0;
+	double deflectError = 0; // relative to the deflected speed
+	for (size_t i = 0; i < N; i++) {
+		Quat4 q = RotToQuat({ rots.pitch[i], rots.yaw[i], rots.roll[i] });
+		quatError = std::max({ quatError, double(std::abs(q.X - quats.x[i])), double(std::abs(q.Y - quats.y[i])),
+			double(std::abs(q.Z - quats.z[i])), double(std::abs(q.W - quats.w[i])) });
+		Rot r = VectorToRot(velocity.get(i));
+		rotError = std::max({ rotError, double(std::abs(r.Pitch - found.pitch[i])), double(std::abs(r.Yaw - found.yaw[i])) });
+		Vec3 d = deflect(velocity.get(i), dir[i], speed[i], roll[i]);
+		deflectError = std::max(deflectError, double((d - deflected.get(i)).magnitude() / std::max(d.magnitude(), 1.0f)));
+	}
+	report("RotToQuatBatch", quatError, 1e-6);
+	report("VectorToRotBatch (uu)", rotError, 0.05);
+	report("deflectBatch (relative)", deflectError, 1e-5);
+
+	return failures == 0 ? 0 : 1;
+}
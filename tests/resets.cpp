@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Checks that cpt_reset_on_ball_ground and cpt_reset_on_goal reset on the
+// first snapshot the game shows the event, even when the ball gets there
+// sooner than predictBall says (off a curved wall, or into the net and back
+// out with goals disabled).
+
+#include "core/rewinder.h"
+
+#include <cstdio>
+
+constexpr float TICK_RATE = 120; // PlayerMove calls per second
+constexpr float INTERVAL = 0.010f; // s between snapshots
+
+// Plays a scripted ball: `ball` until `at`, then `after`.  The goal volume
+// holds the ball from `at` until `until`.
+class StubWorld : public World {
+public:
+	GameState capture() override { return state(); }
+	GameState capture(float) override { return state(); }
+	Vec3 ballLocation() override { return ball().location; }
+	Vec3 ballVelocity() override { return ball().velocity; }
+	float ballRadius() override { return BALL_RADIUS; }
+	bool isInGoal(Vec3) override {
+		goalChecks++;
+		return inGoal && now >= at && now < until;
+	}
+	bool carDoubleJumped() override { return false; }
+	int carWheelContacts() override { return 4; }
+	RewindInput input() override { return RewindInput(); }
+	void takeDodge() override {}
+	void applyBall(const ActorState&) override {}
+	void frozenChanged(bool, bool) override {}
+	void resetShot() override {
+		if (resetAt < 0) {
+			resetAt = now;
+		}
+	}
+	void recorded(const GameState&, float) override {}
+
+	const ActorState& ball() const { return now < at ? before : after; }
+	GameState state() const {
+		GameState s;
+		s.ball = ball();
+		return s;
+	}
+
+	ActorState before, after;
+	float at = 0;
+	float until = 0;
+	bool inGoal = false;
+	float now = 0;
+	float resetAt = -1;
+	int goalChecks = 0;
+};
+
+// Records from a loaded checkpoint for `seconds`; returns when the world
+// asked for a reset, or -1.
+static float play(Rewinder& r, StubWorld& world, float seconds) {
+	r.interval = INTERVAL;
+	r.load(world.state());
+	for (int i = 1; i <= int(seconds * TICK_RATE) && world.resetAt < 0; i++) {
+		world.now = i / TICK_RATE;
+		r.record(world, world.now);
+	}
+	return world.resetAt;
+}
+
+static int expect(const char* name, float resetAt, float at) {
+	bool ok = resetAt >= at && resetAt < at + INTERVAL + 1 / TICK_RATE;
+	printf("%s: reset at %.3f s, ball there at %.3f s%s\n", name, resetAt, at, ok ? "" : " FAILED");
+	return ok ? 0 : 1;
+}
+
+int main() {
+	int failures = 0;
+
+	// Rising in midfield, so predicted to land seconds later, but down on the
+	// ground (rolled off a curved wall) at 0.3 s.
+	{
+		Rewinder r;
+		r.resetOnBallGround = true;
+		r.resetOnGoal = true;
+		StubWorld world;
+		world.before.location = { 0, 0, 1000 };
+		world.before.velocity = { 0, 0, 500 };
+		world.after.location = { 0, 0, BALL_RADIUS };
+		world.at = 0.3f;
+		failures += expect("ground before prediction", play(r, world, 2), world.at);
+		if (world.goalChecks != 0) {
+			printf("ground before prediction: %d goal checks far from the goals FAILED\n", world.goalChecks);
+			failures++;
+		}
+	}
+
+	// Moving away from the goal, then into the net for 20 ms and back out
+	// (goals disabled).
+	{
+		Rewinder r;
+		r.resetOnGoal = true;
+		StubWorld world;
+		world.before.location = { 0, 4000, 300 };
+		world.before.velocity = { 0, -1000, 0 };
+		world.after.location = { 0, 5300, 300 };
+		world.at = 0.5f;
+		world.until = 0.52f;
+		world.inGoal = true;
+		failures += expect("goal before prediction", play(r, world, 2), world.at);
+	}
+
+	// Bouncing up the side wall's curve, past the prediction's flat floor.
+	{
+		Rewinder r;
+		r.resetOnBallGround = true;
+		StubWorld world;
+		world.before.location = { 3700, 0, 400 };
+		world.before.velocity = { 800, 0, 200 };
+		world.after.location = { 3700, 0, BALL_RADIUS + 2 };
+		world.at = 0.2f;
+		failures += expect("ground by the side wall", play(r, world, 2), world.at);
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Checks cpt_weighted_loads' picking: that WeightedSampler picks each index
+// about as often as its weight says, that ShotScheduler holds back the last
+// few picks and lets them go again, and that priorities and misses weigh in
+// for libraries larger than the old fixed-size stats table held.
+
+#include "core/random.h"
+#include "core/scheduler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <deque>
+
+constexpr size_t PICKS = 1000000;
+
+// Returns the number of indices picked more than 5 standard deviations away
+// from their expected count.
+static int checkFrequencies(const char* name, const WeightedSampler& sampler, Rng& rng) {
+	std::vector<size_t> counts(sampler.size());
+	for (size_t k = 0; k < PICKS; k++) {
+		counts[sampler.pick(rng.unit())]++;
+	}
+	int failures = 0;
+	double total = sampler.total();
+	for (size_t i = 0; i < counts.size(); i++) {
+		double p = sampler.weight(i) / total;
+		double expected = p * PICKS;
+		double tolerance = 5 * sqrt(expected * (1 - p)) + 1;
+		if (fabs(counts[i] - expected) > tolerance || (p == 0 && counts[i] > 0)) {
+			printf("%s: index %zu picked %zu times, expected %.0f\n", name, i, counts[i], expected);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+static std::vector<GameState> library(size_t n) {
+	std::vector<GameState> checkpoints(n);
+	for (size_t i = 0; i < n; i++) {
+		checkpoints[i].ball.location = { float(i % 100) * 10, float(i / 100) * 10, 500 };
+	}
+	return checkpoints;
+}
+
+// The weight of a shot with no stats and no priority.
+static double baseWeight() {
+	return 1 + SHOT_MISS_WEIGHT * 0.5;
+}
+
+int main() {
+	int failures = 0;
+	Rng rng(11);
+
+	{
+		WeightedSampler sampler;
+		sampler.assign({ 1, 2, 3, 4, 0, 10 });
+		failures += checkFrequencies("small", sampler, rng);
+		sampler.set(2, 20);
+		sampler.set(5, 0);
+		failures += checkFrequencies("small after set", sampler, rng);
+	}
+	{
+		WeightedSampler sampler;
+		std::vector<double> weights(1000);
+		for (double& w : weights) {
+			w = rng.unit() < 0.1 ? 0 : 0.5 + 4 * rng.unit();
+		}
+		sampler.assign(weights);
+		failures += checkFrequencies("1000 random", sampler, rng);
+	}
+
+	// Every chance matches the shot's weight, held back by SHOT_RECENT_WEIGHT
+	// while it is among the last SHOT_RECENT_PICKS picks.
+	{
+		std::vector<GameState> checkpoints = library(40);
+		std::vector<char> memory(StatsTable::bytesFor(StatsTable::slotsFor(checkpoints.size())));
+		StatsTable stats;
+		stats.attach(memory.data(), memory.size());
+		ShotScheduler scheduler;
+		std::deque<size_t> recent;
+		size_t repeats = 0;
+		size_t mismatches = 0;
+		for (int k = 0; k < 10000; k++) {
+			size_t i = scheduler.next(checkpoints, stats, rng.unit());
+			for (size_t r : recent) {
+				repeats += r == i;
+			}
+			recent.push_back(i);
+			if (recent.size() > SHOT_RECENT_PICKS) {
+				recent.pop_front();
+			}
+			std::vector<double> weights(checkpoints.size(), baseWeight());
+			for (size_t r : recent) {
+				weights[r] = baseWeight() * SHOT_RECENT_WEIGHT;
+			}
+			double total = 0;
+			for (double w : weights) {
+				total += w;
+			}
+			for (size_t j = 0; j < checkpoints.size(); j++) {
+				mismatches += fabs(scheduler.chance(j) - weights[j] / total) > 1e-9;
+			}
+		}
+		// Without the cooldown, 16 of the 40 shots would repeat 40% of the time.
+		double repeatRate = repeats / 10000.0;
+		printf("cooldown: %.1f%% of picks repeat one of the last %zu, %zu wrong chances\n",
+			repeatRate * 100, SHOT_RECENT_PICKS, mismatches);
+		if (repeatRate > 0.05 || mismatches > 0) {
+			printf("cooldown FAILED\n");
+			failures++;
+		}
+	}
+
+	// A library past the 3072 shots the stats file used to hold: every shot
+	// takes a priority and its attempts, and the scheduler weighs them in.
+	{
+		std::vector<GameState> checkpoints = library(5000);
+		std::vector<char> memory(StatsTable::bytesFor(StatsTable::slotsFor(checkpoints.size())));
+		StatsTable stats;
+		stats.attach(memory.data(), memory.size());
+		AttemptOutcome miss;
+		size_t stored = 0;
+		// Even shots were missed once and have priority 1; odd ones have
+		// neither.
+		for (size_t i = 0; i < checkpoints.size(); i++) {
+			uint64_t key = checkpoints[i].hash();
+			stored += i % 2 == 0 ? stats.setPriority(key, 1) && stats.record(key, miss) : stats.setPriority(key, 0);
+		}
+		ShotScheduler scheduler;
+		size_t picked = scheduler.next(checkpoints, stats, 0.5);
+		// One miss in one attempt is a miss rate of (1 + 1) / (1 + 2).
+		double even = (1 + SHOT_MISS_WEIGHT * 2 / 3) * 2;
+		size_t wrong = 0;
+		for (size_t i = 0; i + 1 < checkpoints.size(); i++) {
+			if (i == picked || i + 1 == picked) {
+				continue;
+			}
+			double ratio = scheduler.chance(i) / scheduler.chance(i + 1);
+			double expected = i % 2 == 0 ? even / baseWeight() : baseWeight() / even;
+			wrong += fabs(ratio - expected) > 1e-9;
+		}
+		printf("large library: %zu of %zu shots stored, %zu wrong weights\n", stored, checkpoints.size(), wrong);
+		if (stored != checkpoints.size() || wrong > 0) {
+			printf("large library FAILED\n");
+			failures++;
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
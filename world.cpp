@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "pch.h"
+#include "CheckpointPlugin.h"
+
+// CheckpointPlugin's World implementation: the game access the Rewinder
+// needs on every tick.  tick() has already checked that the ball and car
+// exist.  resetShot() and recorded() are in CheckpointPlugin.cpp.
+
+GameState CheckpointPlugin::capture() {
+	return captureGame(gameWrapper);
+}
+
+GameState CheckpointPlugin::capture(float lastJumped) {
+	return captureGame(gameWrapper, lastJumped);
+}
+
+Vec3 CheckpointPlugin::ballLocation() {
+	return toVec3(gameWrapper->GetGameEventAsServer().GetBall().GetLocation());
+}
+
+Vec3 CheckpointPlugin::ballVelocity() {
+	return toVec3(gameWrapper->GetGameEventAsServer().GetBall().GetVelocity());
+}
+
+float CheckpointPlugin::ballRadius() {
+	return gameWrapper->GetGameEventAsServer().GetBall().GetRadius();
+}
+
+bool CheckpointPlugin::isInGoal(Vec3 location) {
+	return gameWrapper->GetGameEventAsServer().IsInGoal(toVector(location));
+}
+
+bool CheckpointPlugin::carDoubleJumped() {
+	return gameWrapper->GetGameEventAsServer().GetGameCar().GetbDoubleJumped();
+}
+
+int CheckpointPlugin::carWheelContacts() {
+	return gameWrapper->GetGameEventAsServer().GetGameCar().GetNumWheelContacts();
+}
+
+RewindInput CheckpointPlugin::input() {
+	return toRewindInput(gameWrapper->GetGameEventAsServer().GetGameCar().GetInput());
+}
+
+void CheckpointPlugin::takeDodge() {
+	auto c = gameWrapper->GetGameEventAsServer().GetGameCar();
+	c.SetbJumped(true);
+	c.SetbDoubleJumped(true);
+}
+
+void CheckpointPlugin::applyBall(const ActorState& s) {
+	applyActor(s, gameWrapper->GetGameEventAsServer().GetBall());
+}
+
+void CheckpointPlugin::frozenChanged(bool car, bool ball) {
+	cvarManager->getCvar("cpt_car_frozen").setValue(car);
+	cvarManager->getCvar("cpt_ball_frozen").setValue(ball);
+	if (!car) {
+		varianceRng.reseed(varianceRng.next()); // The next resume gets new variance.
+	}
+}